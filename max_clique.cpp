@@ -1,615 +1,7301 @@
-#include <cstdint>
-#include <fstream>
-#include <iomanip>
-#include <iostream>
-#include <memory>
-#include <random>
-#include <set>
-#include <sstream>
-#include <string>
-#include <time.h>
-#include <unordered_map>
-#include <unordered_set>
-#include <vector>
-
-namespace {
-
-const std::unordered_set<int32_t> kEmptySet = {};
-
-struct SaturationNode {
-public:
-    int32_t id;
-    uint32_t saturation;
-    uint32_t uncolored_neighborhood_degree;
-
-    SaturationNode(uint32_t id, uint32_t saturation, uint32_t uncolored_neighborhood_degree):
-            id(id),
-            saturation(saturation),
-            uncolored_neighborhood_degree(uncolored_neighborhood_degree) {
-        // empty on purpose
-    }
-
-    SaturationNode(const SaturationNode& that) = default;
-    SaturationNode& operator=(const SaturationNode& that) = default;
-
-    ~SaturationNode() = default;
-};
-
-struct SaturationComparator {
-    bool operator()(const SaturationNode& lhs, const SaturationNode& rhs) const {
-        return std::tie(lhs.saturation, lhs.uncolored_neighborhood_degree, lhs.id) >
-               std::tie(rhs.saturation, rhs.uncolored_neighborhood_degree, rhs.id);
-    }
-};
-
-
-int32_t GenerateInRange(int32_t start, int32_t finish) {
-    int32_t width = finish - start + 1;
-    return static_cast<int32_t>(std::rand() % width + start);
-}
-
-class Graph {
-private:
-    size_t vertices_count_;
-    std::vector<int32_t> vertices_;
-    std::unordered_map<int32_t, std::unordered_set<int32_t>> adjacency_list_;
-
-public:
-    static std::unique_ptr<Graph> ReadGraphFile(const std::string& filename) {
-        std::ifstream input_stream(filename);
-        std::string line;
-
-        std::unique_ptr<Graph> graph;
-
-        uint32_t vertices = 0;
-        uint32_t edges = 0;
-        while (std::getline(input_stream, line)) {
-            if (line[0] == 'c') {
-                continue;
-            }
-
-            std::stringstream line_input(line);
-            char command;
-
-            if (line[0] == 'p') {
-                std::string type;
-                line_input >> command >> type >> vertices >> edges;
-                graph = std::make_unique<Graph>(vertices);
-            } else {
-                int32_t from;
-                int32_t to;
-                line_input >> command >> from >> to;
-                // Edges in DIMACS file can repeat.
-                graph->AddEdge(from - 1, to - 1);
-            }
-        }
-
-        return graph;
-    }
-
-    explicit Graph(size_t vertices_count):
-            vertices_count_(vertices_count),
-            vertices_(),
-            adjacency_list_() {
-        // empty on purpose
-    }
-    explicit Graph(const std::unordered_set<int32_t>& vertices):
-            vertices_count_(vertices.size()),
-            vertices_(vertices.begin(), vertices.end()),
-            adjacency_list_() {
-        for (const auto& v: vertices) {
-            adjacency_list_[v] = {};
-        }
-    }
-    Graph(const Graph& that) = default;
-    Graph& operator=(const Graph& that) = default;
-
-    [[nodiscard]] inline bool HasEdge(int32_t from, int32_t to) const {
-        const auto& adjacent_to_from_vertexes = adjacency_list_.at(from);
-        const auto& adjacent_to_to_vertexes = adjacency_list_.at(to);
-
-        bool from_has_to = adjacent_to_from_vertexes.find(to) != adjacent_to_from_vertexes.end();
-        bool to_has_from = adjacent_to_to_vertexes.find(from) != adjacent_to_to_vertexes.end();
-        return from_has_to && to_has_from;
-    }
-
-    [[nodiscard]] inline std::vector<int32_t> GetVertices() {
-        if (vertices_.size() != vertices_count_) {
-            vertices_.clear();
-            for (const auto& entry: adjacency_list_) {
-                vertices_.emplace_back(entry.first);
-            }
-        }
-
-        return vertices_;
-    }
-
-    [[nodiscard]] inline uint32_t GetDegree(int32_t vertex) const {
-        if (adjacency_list_.find(vertex) == adjacency_list_.end()) {
-            return 0;
-        }
-
-        return adjacency_list_.at(vertex).size();
-    }
-
-    [[nodiscard]] inline const std::unordered_set<int32_t>& GetAdjacentVertices(int32_t vertex) const {
-        if (adjacency_list_.find(vertex) == adjacency_list_.end()) {
-            return kEmptySet;
-        }
-
-        return adjacency_list_.at(vertex);
-    }
-
-    [[nodiscard]] inline size_t Size() const {
-        return vertices_count_;
-    }
-
-    void AddEdge(int32_t from, int32_t to) {
-        if (adjacency_list_.find(from) == adjacency_list_.end()) {
-            adjacency_list_[from] = {};
-        }
-        adjacency_list_[from].insert(to);
-
-        if (adjacency_list_.find(to) == adjacency_list_.end()) {
-            adjacency_list_[to] = {};
-        }
-        adjacency_list_[to].insert(from);
-    }
-
-    void RemoveEdge(int32_t from, int32_t to) {
-        adjacency_list_[from].erase(to);
-        adjacency_list_[to].erase(from);
-    }
-
-
-    // [vertex, degree]
-    [[nodiscard]] std::vector<std::tuple<int32_t, uint32_t>> SortVerticesByDegree(
-            const std::unordered_set<int32_t>& vertices) const {
-        std::vector<std::tuple<int32_t, uint32_t>> result;
-
-        for (const auto& i: vertices) {
-            uint32_t degree = 0;
-
-            for (const auto& j: vertices) {
-                if (i == j) {
-                    continue;
-                }
-
-                if (HasEdge(i, j)) {
-                    degree += 1;
-                }
-            }
-
-            result.emplace_back(i, degree);
-        }
-
-        std::sort(result.begin(), result.end(), [](const std::tuple<int32_t, uint32_t>& one,
-                                                   const std::pair<int32_t, uint32_t>& another) {
-            return std::tie(std::get<1>(one), std::get<0>(one)) >
-                std::tie(std::get<1>(another), std::get<0>(another));
-        });
-
-        return result;
-    }
-
-
-    [[nodiscard]] std::vector<std::tuple<int32_t, int32_t, int32_t>> SortVerticesByColor(
-            const std::unordered_set<int32_t>& vertices) const {
-        if (vertices.empty()) {
-            return {};
-        }
-
-        Graph sub_graph(vertices);
-
-        for (const auto& v: vertices) {
-            const auto& neighbours = GetAdjacentVertices(v);
-
-            for (const auto& n: neighbours) {
-                if (vertices.find(n) != vertices.end()) {
-                    sub_graph.AddEdge(v, n);
-                }
-            }
-        }
-
-        std::set<SaturationNode, SaturationComparator> queue;
-
-        std::unordered_map<int32_t, uint32_t> vertices_degrees;
-        std::unordered_map<int32_t, std::unordered_set<int32_t>> adjacent_colors;
-
-        std::unordered_map<int32_t, int32_t> colors;
-
-        for (const auto& i: sub_graph.GetVertices()) {
-            const auto& adjacent_vertices = sub_graph.GetAdjacentVertices(i);
-
-            // let's reset all colors to kColorNoColor
-            colors[i] = -1;
-            vertices_degrees[i] = adjacent_vertices.size();
-
-            queue.insert(SaturationNode(static_cast<uint32_t>(i),
-                                        static_cast<uint32_t>(adjacent_colors[i].size()),
-                                        vertices_degrees[i]));
-        }
-
-        while (!queue.empty()) {
-            const auto queue_iterator = queue.begin();
-            SaturationNode node = *queue_iterator;
-            queue.erase(queue_iterator);
-
-            int32_t current_color = -1;
-            std::vector<bool> available_colors(colors.size(), true);
-            for (const auto& neighbour: sub_graph.GetAdjacentVertices(node.id)) {
-                int32_t color = colors[neighbour];
-                if (color != -1) {
-                    available_colors[color] = false;
-                }
-            }
-            for (size_t color = 0; color < available_colors.size(); color++) {
-                if (available_colors[color]) {
-                    current_color = color;
-                    break;
-                }
-            }
-
-            colors[node.id] = current_color;
-
-            for (const auto& neighbour: sub_graph.GetAdjacentVertices(node.id)) {
-                if (colors[neighbour] != -1) {
-                    continue;
-                }
-
-                SaturationNode old_neighbour_state(static_cast<uint32_t>(neighbour),
-                                                   static_cast<uint32_t>(adjacent_colors[neighbour].size()),
-                                                   vertices_degrees[neighbour]);
-
-                if (adjacent_colors.find(neighbour) == adjacent_colors.end()) {
-                    adjacent_colors[neighbour] = {};
-                }
-
-                adjacent_colors[neighbour].insert(current_color);
-                vertices_degrees[neighbour] -= 1;
-                queue.erase(old_neighbour_state);
-
-                SaturationNode new_neighbour_state(static_cast<uint32_t>(neighbour),
-                                                   static_cast<uint32_t>(adjacent_colors[neighbour].size()),
-                                                   vertices_degrees[neighbour]);
-
-                queue.insert(new_neighbour_state);
-            }
-        }
-
-        std::vector<std::tuple<int32_t, int32_t, int32_t>> result;
-        std::unordered_map<int32_t, std::unordered_map<int32_t, uint32_t>> colors_degree;
-
-        for (const auto& v: sub_graph.GetVertices()) {
-            const auto& neighbours = sub_graph.GetAdjacentVertices(v);
-
-            if (colors_degree.find(v) == colors_degree.end()) {
-                colors_degree[v] = {};
-            }
-
-            for (const auto& neighbour: neighbours) {
-                const auto& neighbour_color = colors[neighbour];
-
-
-
-                if (colors_degree[v].find(neighbour_color) == colors_degree[v].end()) {
-                    colors_degree[v][neighbour_color] = 0;
-                }
-
-                colors_degree[v][neighbour_color] += 1;
-            }
-        }
-
-        for (const auto& v: sub_graph.GetVertices()) {
-            result.emplace_back(v, colors_degree[v].size(), sub_graph.GetDegree(v));
-        }
-
-        std::sort(result.begin(), result.end(), [](const std::tuple<int32_t, int32_t, int32_t>& one,
-                                                   const std::tuple<int32_t, int32_t, int32_t>& another) {
-            return std::tie(std::get<1>(one), std::get<2>(one), std::get<0>(one)) >
-                std::tie(std::get<1>(another), std::get<2>(another), std::get<0>(another));
-        });
-
-        return result;
-    }
-
-    ~Graph() = default;
-};
-
-class Clique {
-private:
-    Graph* graph_;
-
-    std::vector<int32_t> vertices_;
-    std::unordered_set<int32_t> vertices_lookup_;
-
-    std::unordered_set<int32_t> candidates_;
-
-public:
-    Clique(int32_t vertex,
-           Graph* graph):
-        graph_(graph),
-        vertices_(),
-        vertices_lookup_(),
-        candidates_() {
-        vertices_.push_back(vertex);
-        vertices_lookup_.insert(vertex);
-
-        for (int32_t v = 0; v < graph_->Size(); v++) {
-            if (graph_->HasEdge(vertex, v)) {
-                candidates_.insert(v);
-            }
-        }
-    }
-
-    Clique(const Clique& that) = default;
-    Clique& operator=(const Clique& that) = default;
-
-    [[nodiscard]] inline std::vector<int32_t> GetVertices() const {
-        return vertices_;
-    }
-
-    [[nodiscard]] inline std::unordered_set<int32_t> GetCandidates() const {
-        return candidates_;
-    }
-
-    [[nodiscard]] inline bool IsCandidate(int32_t vertex) const {
-        return candidates_.find(vertex) != candidates_.end();
-    }
-
-    bool AddVertex(int32_t vertex) {
-        if (vertices_lookup_.find(vertex) != vertices_lookup_.end()) {
-            return false;
-        }
-
-        vertices_.push_back(vertex);
-        vertices_lookup_.insert(vertex);
-
-        std::vector<int32_t> should_be_removed;
-        for (const auto& c: candidates_) {
-            if (!graph_->HasEdge(c, vertex)) {
-                should_be_removed.push_back(c);
-            }
-        }
-
-        for (const auto& vr: should_be_removed) {
-            candidates_.erase(vr);
-        }
-
-        return true;
-    }
-
-    bool RemoveVertex(int32_t vertex) {
-        if (vertices_lookup_.find(vertex) == vertices_lookup_.end()) {
-            return false;
-        }
-
-        vertices_.erase(
-                std::remove(vertices_.begin(), vertices_.end(), vertex), vertices_.end());
-        vertices_lookup_.erase(vertex);
-
-        for (const auto& n: graph_->GetAdjacentVertices(vertex)) {
-            bool adjacent_to_all_others = true;
-
-            for (const auto& v: vertices_) {
-                if (!graph_->HasEdge(n, v)) {
-                    adjacent_to_all_others = false;
-                    break;
-                }
-            }
-
-            if (adjacent_to_all_others) {
-                candidates_.insert(n);
-            }
-        }
-
-        return true;
-    }
-
-    [[nodiscard]] bool Verify() const {
-        std::unordered_set<int32_t> unique;
-
-        for (const auto& node: vertices_) {
-            unique.insert(node);
-        }
-
-        if (unique.size() != vertices_.size()) {
-            std::cout << "Duplicated vertices in the clique\n";
-            return false;
-        }
-
-        for (const auto& i: vertices_) {
-            for (const auto& j: vertices_) {
-                if (i != j && !graph_->HasEdge(i, j)) {
-                    std::cout << "Returned subgraph is not a clique\n";
-                    return false;
-                }
-            }
-        }
-        return true;
-    }
-
-    [[nodiscard]] inline bool IsNeededMoreCandidates() const {
-        return !candidates_.empty();
-    }
-
-    [[nodiscard]] inline size_t CandidatesSize() const {
-        return candidates_.size();
-    }
-
-    [[nodiscard]] inline size_t Size() const {
-        return vertices_.size();
-    }
-
-    ~Clique() = default;
-};
-
-class MaxCliqueProblem {
-private:
-    std::unique_ptr<Graph> graph_;
-    std::unique_ptr<Clique> best_clique_;
-
-public:
-    static MaxCliqueProblem FromFile(const std::string& file) {
-        return MaxCliqueProblem(Graph::ReadGraphFile(file));
-    }
-
-    explicit MaxCliqueProblem(std::unique_ptr<Graph> graph):
-        graph_(std::move(graph)),
-        best_clique_() {
-        // empty on purpose
-    }
-
-    MaxCliqueProblem(const MaxCliqueProblem& that) = delete;
-    MaxCliqueProblem& operator=(const MaxCliqueProblem& that) = delete;
-    MaxCliqueProblem(MaxCliqueProblem&& that) = default;
-    MaxCliqueProblem& operator=(MaxCliqueProblem&& that) = default;
-
-    [[nodiscard]] inline std::vector<int32_t> GetBestClique() const {
-        return best_clique_->GetVertices();
-    }
-
-    [[nodiscard]] inline bool IsCliqueValid() const {
-        return best_clique_ != nullptr && best_clique_->Verify();
-    }
-
-    void FindClique() {
-        std::unordered_set<int32_t> vertices;
-        for (int32_t v = 0; v < graph_->Size(); v++) {
-            vertices.insert(v);
-        }
-
-        const auto& candidates = graph_->SortVerticesByColor(vertices);
-        int32_t vertex = std::get<0>(candidates[0]);
-
-        std::unique_ptr<Clique> init_clique = std::make_unique<Clique>(vertex, graph_.get());
-
-        while (init_clique->IsNeededMoreCandidates()) {
-            const auto& candidates = graph_->SortVerticesByColor(init_clique->GetCandidates());
-            const auto& candidate = std::get<0>(candidates[0]);
-            init_clique->AddVertex(candidate);
-        }
-
-        best_clique_ = std::move(init_clique);
-
-        for (int32_t step = 0; step < 130; step++) {
-            Clique* old_clique = best_clique_.get();
-            std::unique_ptr<Clique> new_clique = std::make_unique<Clique>(*old_clique);
-
-            const auto& clique_vertices = new_clique->GetVertices();
-
-            std::unordered_set<int32_t> vertices_to_remove;
-            vertices_to_remove.insert(GenerateInRange(0, static_cast<int32_t>(clique_vertices.size()) - 1));
-
-            int32_t max_amount_to_remove = std::max(1, static_cast<int32_t>(new_clique->Size() * 0.7));
-
-            // Starts from 1 as we already removed one.
-            for (int32_t amount_to_remove = 1; amount_to_remove < max_amount_to_remove; amount_to_remove++) {
-                int32_t new_vertex = GenerateInRange(0, static_cast<int32_t>(clique_vertices.size()) - 1);
-                while (vertices_to_remove.find(new_vertex) != vertices_to_remove.end()) {
-                    new_vertex = GenerateInRange(0, static_cast<int32_t>(clique_vertices.size()) - 1);
-                }
-
-                vertices_to_remove.insert(new_vertex);
-            }
-
-            for (const auto& vri: vertices_to_remove) {
-                if (!new_clique->RemoveVertex(clique_vertices[vri])) {
-                    throw std::runtime_error("Trying to remove vertex that is not in clique");
-                }
-            }
-
-            while (new_clique->IsNeededMoreCandidates()) {
-                const auto& candidates = graph_->SortVerticesByColor(new_clique->GetCandidates());
-                // consider top 5 indexes.
-                const auto& random_index = GenerateInRange(0, 1);
-                int32_t index = std::min(random_index, static_cast<int32_t>(candidates.size()) - 1);
-
-                const auto& candidate = std::get<0>(candidates[index]);
-                new_clique->AddVertex(candidate);
-            }
-
-            if (new_clique->Size() > best_clique_->Size()) {
-                best_clique_ = std::move(new_clique);
-            }
-        }
-    }
-};
-
-double RoundTo(double value, double precision = 1.0) {
-    return std::round(value / precision) * precision;
-}
-
-template<typename T>
-std::string ConvertToString(
-        const std::vector<T>& collection,
-        const std::string& delimiter = " ") {
-    std::ostringstream os;
-    for (size_t i = 0; i < collection.size(); i++) {
-        os << collection[i];
-        if (i != collection.size() -1 ) {
-            os << delimiter;
-        }
-    }
-    return os.str();
-}
-
-} // namespace
-
-int main() {
-    std::vector<std::string> files = { "brock200_1.clq", "brock200_2.clq", "brock200_3.clq", "brock200_4.clq",
-                                       "brock400_1.clq", "brock400_2.clq", "brock400_3.clq", "brock400_4.clq",
-                                       "C125.9.clq",
-                                       "gen200_p0.9_44.clq", "gen200_p0.9_55.clq",
-                                       "hamming8-4.clq",
-                                       "johnson16-2-4.clq", "johnson8-2-4.clq",
-                                       "keller4.clq",
-                                       "MANN_a27.clq", "MANN_a9.clq",
-                                       "p_hat1000-1.clq", "p_hat1000-2.clq",
-                                       "p_hat1500-1.clq",
-                                       "p_hat300-3.clq", "p_hat500-3.clq",
-                                       "san1000.clq",
-                                       "sanr200_0.9.clq", "sanr400_0.7.clq"
-    };
-
-    std::ofstream fout("clique.csv");
-
-    std::cout << std::setfill(' ') << std::setw(20) << "Instance"
-              << std::setfill(' ') << std::setw(10) << "Clique"
-              << std::setfill(' ') << std::setw(15) << "Time, sec"
-              << std::endl;
-
-    fout << "File; Clique; Time (sec); Clique vertices" << std::endl;
-    for(const auto& file: files) {
-        MaxCliqueProblem problem = MaxCliqueProblem::FromFile("data/" + file);
-        clock_t start = clock();
-
-        problem.FindClique();
-
-        clock_t end = clock();
-        clock_t ticks_diff = end - start;
-        double seconds_diff = RoundTo(double(ticks_diff) / CLOCKS_PER_SEC, 0.001);
-
-        if (!problem.IsCliqueValid()) {
-            std::cout << "*** WARNING: incorrect clique ***\n";
-            fout << "*** WARNING: incorrect clique ***\n";
-            continue;
-        }
-
-        const auto& best_clique = problem.GetBestClique();
-
-        fout << file << "; "
-             << best_clique.size() << "; "
-             << double(clock() - start) / CLOCKS_PER_SEC << "; "
-             << ConvertToString(best_clique, ", ")
-             << std::endl;
-
-        std::cout << std::setfill(' ') << std::setw(20) << file
-                  << std::setfill(' ') << std::setw(10) << best_clique.size()
-                  << std::setfill(' ') << std::setw(15) << seconds_diff
-                  << std::endl;
-    }
-
-    fout.close();
-    return 0;
-}
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <immintrin.h>
+#include <glob.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kCacheLineSize = 64;
+constexpr size_t kWordBits = 64;
+constexpr size_t kWordsPerCacheLine = kCacheLineSize / sizeof(uint64_t);
+
+const std::unordered_set<int32_t> kEmptySet = {};
+
+// Build with -DMAX_CLIQUE_PROFILE to time the solver phases and count hot path events,
+// otherwise PROFILE_PHASE and PROFILE_COUNT expand to nothing and cost nothing.
+#ifdef MAX_CLIQUE_PROFILE
+
+enum class ProfilePhase {
+    kLoad,
+    kConstruction,
+    kReduction,
+    kPerturbation,
+    // Completion of a clique by the colouring ranking.
+    kRebuild,
+    kColoring,
+    kTabu,
+    kExact,
+    kVerification,
+    kCount
+};
+
+enum class ProfileCounter {
+    kHasEdge,
+    kColorings,
+    // Candidates dropped from cliques by new members or reductions.
+    kCandidatesFiltered,
+    kAllocations,
+    // Allocations made by the heuristic workers after their first round.
+    kSteadyAllocations,
+    kCount
+};
+
+std::string ToString(ProfilePhase phase) {
+    static const char* const kNames[] = { "load", "construction", "reduction", "perturbation", "rebuild",
+                                          "coloring", "tabu", "exact", "verification" };
+    return kNames[static_cast<size_t>(phase)];
+}
+
+std::string ToString(ProfileCounter counter) {
+    static const char* const kNames[] = { "has_edge", "colorings", "candidates_filtered", "allocations",
+                                          "steady_allocations" };
+    return kNames[static_cast<size_t>(counter)];
+}
+
+struct ProfileSnapshot {
+    uint64_t phase_nanoseconds[static_cast<size_t>(ProfilePhase::kCount)] = {};
+    uint64_t counters[static_cast<size_t>(ProfileCounter::kCount)] = {};
+
+    void Add(const ProfileSnapshot& that) {
+        for (size_t i = 0; i < static_cast<size_t>(ProfilePhase::kCount); i++) {
+            phase_nanoseconds[i] += that.phase_nanoseconds[i];
+        }
+        for (size_t i = 0; i < static_cast<size_t>(ProfileCounter::kCount); i++) {
+            counters[i] += that.counters[i];
+        }
+    }
+};
+
+// Every thread counts into its own block, blocks of finished threads are folded into |retired_|.
+// Snapshot and Reset are only meant to be called while no solver threads run.
+class Profiler {
+private:
+    struct alignas(kCacheLineSize) LocalBlock {
+        ProfileSnapshot values;
+
+        LocalBlock(): values() {
+            std::lock_guard<std::mutex> lock(Mutex());
+            Blocks().push_back(this);
+        }
+
+        ~LocalBlock() {
+            std::lock_guard<std::mutex> lock(Mutex());
+            Retired().Add(values);
+            Blocks().erase(std::remove(Blocks().begin(), Blocks().end(), this), Blocks().end());
+        }
+    };
+
+    static std::mutex& Mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::vector<LocalBlock*>& Blocks() {
+        static std::vector<LocalBlock*> blocks;
+        return blocks;
+    }
+
+    static ProfileSnapshot& Retired() {
+        static ProfileSnapshot retired;
+        return retired;
+    }
+
+    static inline LocalBlock& Local() {
+        thread_local LocalBlock block;
+        return block;
+    }
+
+public:
+    static inline void Count(ProfileCounter counter, uint64_t amount) {
+        Local().values.counters[static_cast<size_t>(counter)] += amount;
+    }
+
+    static inline void AddTime(ProfilePhase phase, uint64_t nanoseconds) {
+        Local().values.phase_nanoseconds[static_cast<size_t>(phase)] += nanoseconds;
+    }
+
+    // Counted by the global operator new, which may run before any block exists.
+    static std::atomic<uint64_t>& Allocations() {
+        static std::atomic<uint64_t> allocations(0);
+        return allocations;
+    }
+
+    // Allocations of the calling thread, constant initialised so operator new can use it.
+    static uint64_t& ThreadAllocations() {
+        thread_local uint64_t allocations = 0;
+        return allocations;
+    }
+
+    static ProfileSnapshot Snapshot() {
+        std::lock_guard<std::mutex> lock(Mutex());
+        ProfileSnapshot snapshot = Retired();
+        for (const auto& block: Blocks()) {
+            snapshot.Add(block->values);
+        }
+        snapshot.counters[static_cast<size_t>(ProfileCounter::kAllocations)] +=
+                Allocations().load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+    static void Reset() {
+        std::lock_guard<std::mutex> lock(Mutex());
+        Retired() = ProfileSnapshot();
+        for (auto& block: Blocks()) {
+            block->values = ProfileSnapshot();
+        }
+        Allocations().store(0, std::memory_order_relaxed);
+    }
+};
+
+// Adds the lifetime of the scope to |phase|. Phases nest, so their times overlap.
+class ScopedPhase {
+private:
+    ProfilePhase phase_;
+    std::chrono::steady_clock::time_point start_;
+
+public:
+    explicit ScopedPhase(ProfilePhase phase):
+        phase_(phase),
+        start_(std::chrono::steady_clock::now()) {
+        // empty on purpose
+    }
+
+    ScopedPhase(const ScopedPhase& that) = delete;
+    ScopedPhase& operator=(const ScopedPhase& that) = delete;
+
+    ~ScopedPhase() {
+        Profiler::AddTime(phase_, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_).count()));
+    }
+};
+
+#define PROFILE_CONCAT_INNER(lhs, rhs) lhs##rhs
+#define PROFILE_CONCAT(lhs, rhs) PROFILE_CONCAT_INNER(lhs, rhs)
+#define PROFILE_PHASE(phase) ScopedPhase PROFILE_CONCAT(profile_phase_, __LINE__)(ProfilePhase::phase)
+#define PROFILE_COUNT(counter, amount) Profiler::Count(ProfileCounter::counter, (amount))
+
+#else
+
+#define PROFILE_PHASE(phase) static_cast<void>(0)
+#define PROFILE_COUNT(counter, amount) static_cast<void>(0)
+
+#endif
+
+template<typename T, size_t Alignment = kCacheLineSize>
+struct AlignedAllocator {
+public:
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+
+    template<typename U>
+    explicit AlignedAllocator(const AlignedAllocator<U, Alignment>& that) {
+        // empty on purpose
+    }
+
+    [[nodiscard]] T* allocate(size_t size) {
+        return static_cast<T*>(::operator new(size * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* pointer, size_t) {
+        ::operator delete(pointer, std::align_val_t(Alignment));
+    }
+
+    bool operator==(const AlignedAllocator&) const {
+        return true;
+    }
+
+    bool operator!=(const AlignedAllocator&) const {
+        return false;
+    }
+};
+
+using AlignedWords = std::vector<uint64_t, AlignedAllocator<uint64_t>>;
+
+// Number of 64-bit words needed to keep |bits| bits, padded to a whole cache line
+// so every row of an adjacency matrix starts on its own line.
+inline size_t WordsForBits(size_t bits) {
+    size_t words = (bits + kWordBits - 1) / kWordBits;
+    return (words + kWordsPerCacheLine - 1) / kWordsPerCacheLine * kWordsPerCacheLine;
+}
+
+template<typename F>
+inline void ForEachBit(const uint64_t* words, size_t words_count, F&& callback) {
+    for (size_t w = 0; w < words_count; w++) {
+        uint64_t word = words[w];
+        while (word != 0) {
+            callback(static_cast<int32_t>(w * kWordBits + __builtin_ctzll(word)));
+            word &= word - 1;
+        }
+    }
+}
+
+// Word-array kernels behind BitSet and the branch and bound colouring. Every instruction set
+// gets its own copy compiled with a target attribute, so the binary runs on any x86-64 CPU
+// and picks the kernels at startup.
+enum class SimdLevel {
+    kScalar,
+    kAvx2,
+    // AVX-512F with the VPOPCNTDQ extension.
+    kAvx512
+};
+
+std::string ToString(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::kScalar:
+            return "scalar";
+        case SimdLevel::kAvx2:
+            return "avx2";
+        case SimdLevel::kAvx512:
+            return "avx512";
+    }
+    return "unknown";
+}
+
+struct BitKernels {
+    SimdLevel level;
+    // words &= row
+    void (*and_words)(uint64_t* words, const uint64_t* row, size_t count);
+    // words &= ~row
+    void (*and_not_words)(uint64_t* words, const uint64_t* row, size_t count);
+    // popcount(words & row)
+    size_t (*and_count)(const uint64_t* words, const uint64_t* row, size_t count);
+    // popcount(words)
+    size_t (*count)(const uint64_t* words, size_t count);
+};
+
+void AndWordsScalar(uint64_t* words, const uint64_t* row, size_t count) {
+    for (size_t w = 0; w < count; w++) {
+        words[w] &= row[w];
+    }
+}
+
+void AndNotWordsScalar(uint64_t* words, const uint64_t* row, size_t count) {
+    for (size_t w = 0; w < count; w++) {
+        words[w] &= ~row[w];
+    }
+}
+
+size_t AndCountScalar(const uint64_t* words, const uint64_t* row, size_t count) {
+    size_t result = 0;
+    for (size_t w = 0; w < count; w++) {
+        result += __builtin_popcountll(words[w] & row[w]);
+    }
+    return result;
+}
+
+size_t CountScalar(const uint64_t* words, size_t count) {
+    size_t result = 0;
+    for (size_t w = 0; w < count; w++) {
+        result += __builtin_popcountll(words[w]);
+    }
+    return result;
+}
+
+__attribute__((target("avx2"))) void AndWordsAvx2(uint64_t* words, const uint64_t* row, size_t count) {
+    size_t w = 0;
+    for (; w + 4 <= count; w += 4) {
+        auto* target = reinterpret_cast<__m256i*>(words + w);
+        const __m256i value = _mm256_loadu_si256(target);
+        _mm256_storeu_si256(target, _mm256_and_si256(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + w))));
+    }
+    for (; w < count; w++) {
+        words[w] &= row[w];
+    }
+}
+
+__attribute__((target("avx2"))) void AndNotWordsAvx2(uint64_t* words, const uint64_t* row, size_t count) {
+    size_t w = 0;
+    for (; w + 4 <= count; w += 4) {
+        auto* target = reinterpret_cast<__m256i*>(words + w);
+        const __m256i value = _mm256_loadu_si256(target);
+        _mm256_storeu_si256(target, _mm256_andnot_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + w)), value));
+    }
+    for (; w < count; w++) {
+        words[w] &= ~row[w];
+    }
+}
+
+// Per byte popcount through a nibble lookup table (Mula), AVX2 has no vector popcount.
+__attribute__((target("avx2"))) inline __m256i PopcountBytesAvx2(__m256i value) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    const __m256i low = _mm256_and_si256(value, low_mask);
+    const __m256i high = _mm256_and_si256(_mm256_srli_epi16(value, 4), low_mask);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low), _mm256_shuffle_epi8(lookup, high));
+}
+
+__attribute__((target("avx2,popcnt"))) size_t AndCountAvx2(const uint64_t* words, const uint64_t* row, size_t count) {
+    __m256i total = _mm256_setzero_si256();
+    size_t w = 0;
+    for (; w + 4 <= count; w += 4) {
+        const __m256i value = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + w)),
+                                               _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + w)));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(PopcountBytesAvx2(value), _mm256_setzero_si256()));
+    }
+
+    size_t result = static_cast<size_t>(_mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1) +
+                                        _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3));
+    for (; w < count; w++) {
+        result += _mm_popcnt_u64(words[w] & row[w]);
+    }
+    return result;
+}
+
+__attribute__((target("avx2,popcnt"))) size_t CountAvx2(const uint64_t* words, size_t count) {
+    __m256i total = _mm256_setzero_si256();
+    size_t w = 0;
+    for (; w + 4 <= count; w += 4) {
+        const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + w));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(PopcountBytesAvx2(value), _mm256_setzero_si256()));
+    }
+
+    size_t result = static_cast<size_t>(_mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1) +
+                                        _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3));
+    for (; w < count; w++) {
+        result += _mm_popcnt_u64(words[w]);
+    }
+    return result;
+}
+
+// Tails are handled by masked loads and stores, bitsets are padded to whole cache lines anyway.
+__attribute__((target("avx512f"))) void AndWordsAvx512(uint64_t* words, const uint64_t* row, size_t count) {
+    for (size_t w = 0; w < count; w += 8) {
+        const __mmask8 mask = count - w >= 8 ? 0xff : static_cast<__mmask8>((1U << (count - w)) - 1);
+        const __m512i value = _mm512_maskz_loadu_epi64(mask, words + w);
+        _mm512_mask_storeu_epi64(words + w, mask, _mm512_and_si512(value, _mm512_maskz_loadu_epi64(mask, row + w)));
+    }
+}
+
+__attribute__((target("avx512f"))) void AndNotWordsAvx512(uint64_t* words, const uint64_t* row, size_t count) {
+    for (size_t w = 0; w < count; w += 8) {
+        const __mmask8 mask = count - w >= 8 ? 0xff : static_cast<__mmask8>((1U << (count - w)) - 1);
+        const __m512i value = _mm512_maskz_loadu_epi64(mask, words + w);
+        _mm512_mask_storeu_epi64(words + w, mask,
+                                 _mm512_mask_andnot_epi64(value, mask, _mm512_maskz_loadu_epi64(mask, row + w), value));
+    }
+}
+
+__attribute__((target("avx512f"))) inline size_t SumLanes(__m512i value) {
+    alignas(kCacheLineSize) uint64_t lanes[8];
+    _mm512_store_si512(lanes, value);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq"))) size_t AndCountAvx512(const uint64_t* words,
+                                                                          const uint64_t* row,
+                                                                          size_t count) {
+    __m512i total = _mm512_setzero_si512();
+    for (size_t w = 0; w < count; w += 8) {
+        const __mmask8 mask = count - w >= 8 ? 0xff : static_cast<__mmask8>((1U << (count - w)) - 1);
+        const __m512i value = _mm512_and_si512(_mm512_maskz_loadu_epi64(mask, words + w),
+                                               _mm512_maskz_loadu_epi64(mask, row + w));
+        total = _mm512_add_epi64(total, _mm512_popcnt_epi64(value));
+    }
+    return SumLanes(total);
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq"))) size_t CountAvx512(const uint64_t* words, size_t count) {
+    __m512i total = _mm512_setzero_si512();
+    for (size_t w = 0; w < count; w += 8) {
+        const __mmask8 mask = count - w >= 8 ? 0xff : static_cast<__mmask8>((1U << (count - w)) - 1);
+        total = _mm512_add_epi64(total, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(mask, words + w)));
+    }
+    return SumLanes(total);
+}
+
+[[nodiscard]] bool IsSimdLevelSupported(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::kScalar:
+            return true;
+        case SimdLevel::kAvx2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+        case SimdLevel::kAvx512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+    }
+    return false;
+}
+
+[[nodiscard]] const BitKernels& GetBitKernels(SimdLevel level) {
+    static const BitKernels kScalar = { SimdLevel::kScalar, AndWordsScalar, AndNotWordsScalar, AndCountScalar, CountScalar };
+    static const BitKernels kAvx2 = { SimdLevel::kAvx2, AndWordsAvx2, AndNotWordsAvx2, AndCountAvx2, CountAvx2 };
+    static const BitKernels kAvx512 = { SimdLevel::kAvx512, AndWordsAvx512, AndNotWordsAvx512, AndCountAvx512, CountAvx512 };
+
+    switch (level) {
+        case SimdLevel::kAvx2:
+            return kAvx2;
+        case SimdLevel::kAvx512:
+            return kAvx512;
+        default:
+            return kScalar;
+    }
+}
+
+// AVX-512 is opt-in: it wins on long rows in isolation, but the branch and bound mostly works on
+// short row tails where the masked 512-bit path measured slower than AVX2.
+[[nodiscard]] SimdLevel DetectSimdLevel() {
+    if (IsSimdLevelSupported(SimdLevel::kAvx2)) {
+        return SimdLevel::kAvx2;
+    }
+    return SimdLevel::kScalar;
+}
+
+// Kernels used by the solver, the best supported ones unless SelectBitKernels says otherwise.
+[[nodiscard]] inline const BitKernels*& ActiveBitKernels() {
+    static const BitKernels* kernels = &GetBitKernels(DetectSimdLevel());
+    return kernels;
+}
+
+[[nodiscard]] inline const BitKernels& Kernels() {
+    return *ActiveBitKernels();
+}
+
+// Not thread safe, meant to be called before solving.
+void SelectBitKernels(SimdLevel level) {
+    if (!IsSimdLevelSupported(level)) {
+        throw std::runtime_error("The CPU does not support " + ToString(level));
+    }
+    ActiveBitKernels() = &GetBitKernels(level);
+}
+
+class BitSet {
+private:
+    size_t size_;
+    AlignedWords words_;
+
+public:
+    explicit BitSet(size_t size = 0):
+            size_(size),
+            words_(WordsForBits(size), 0) {
+        // empty on purpose
+    }
+
+    BitSet(const BitSet& that) = default;
+    BitSet& operator=(const BitSet& that) = default;
+    BitSet(BitSet&& that) = default;
+    BitSet& operator=(BitSet&& that) = default;
+
+    [[nodiscard]] inline bool Test(int32_t bit) const {
+        return (words_[bit / kWordBits] >> (bit % kWordBits)) & 1ULL;
+    }
+
+    inline void Set(int32_t bit) {
+        words_[bit / kWordBits] |= 1ULL << (bit % kWordBits);
+    }
+
+    inline void Reset(int32_t bit) {
+        words_[bit / kWordBits] &= ~(1ULL << (bit % kWordBits));
+    }
+
+    inline void Clear() {
+        std::fill(words_.begin(), words_.end(), 0);
+    }
+
+    [[nodiscard]] inline size_t Count() const {
+        return Kernels().count(words_.data(), words_.size());
+    }
+
+    [[nodiscard]] inline bool Empty() const {
+        for (const auto& word: words_) {
+            if (word != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // |row| must have at least WordsCount() words.
+    inline void And(const uint64_t* row) {
+        Kernels().and_words(words_.data(), row, words_.size());
+    }
+
+    [[nodiscard]] inline size_t AndCount(const uint64_t* row) const {
+        return Kernels().and_count(words_.data(), row, words_.size());
+    }
+
+    template<typename F>
+    inline void ForEach(F&& callback) const {
+        ForEachBit(words_.data(), words_.size(), std::forward<F>(callback));
+    }
+
+    [[nodiscard]] inline const uint64_t* Data() const {
+        return words_.data();
+    }
+
+    [[nodiscard]] inline uint64_t* Data() {
+        return words_.data();
+    }
+
+    [[nodiscard]] inline size_t WordsCount() const {
+        return words_.size();
+    }
+
+    [[nodiscard]] inline size_t Size() const {
+        return size_;
+    }
+
+    ~BitSet() = default;
+};
+
+// xoshiro256** of Blackman and Vigna: 32 bytes of state and a few cycles per number, where
+// std::mt19937 keeps 2.5 KB. Seeded through splitmix64, and every stream starts 2^128 numbers
+// after the previous one, so the workers never share a sequence.
+class Xoshiro256 {
+public:
+    using result_type = uint64_t;
+
+    static constexpr size_t kStateWords = 4;
+
+private:
+    uint64_t state_[kStateWords];
+
+    [[nodiscard]] static inline uint64_t RotateLeft(uint64_t value, int shift) {
+        return (value << shift) | (value >> (64 - shift));
+    }
+
+    // Advances the state by 2^128 numbers.
+    void Jump() {
+        static constexpr uint64_t kJump[] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+                                              0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+        uint64_t jumped[4] = { 0, 0, 0, 0 };
+        for (const auto& word: kJump) {
+            for (int bit = 0; bit < 64; bit++) {
+                if ((word >> bit) & 1ULL) {
+                    for (int i = 0; i < 4; i++) {
+                        jumped[i] ^= state_[i];
+                    }
+                }
+                (*this)();
+            }
+        }
+        std::copy(jumped, jumped + 4, state_);
+    }
+
+public:
+    explicit Xoshiro256(uint64_t seed = 1, uint64_t stream = 0):
+            state_() {
+        for (auto& word: state_) {
+            seed += 0x9E3779B97F4A7C15ULL;
+            uint64_t mixed = seed;
+            mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+            word = mixed ^ (mixed >> 31);
+        }
+        for (uint64_t i = 0; i < stream; i++) {
+            Jump();
+        }
+    }
+
+    Xoshiro256(const Xoshiro256& other) = default;
+    Xoshiro256(Xoshiro256&& other) = default;
+    Xoshiro256& operator=(const Xoshiro256& other) = default;
+    Xoshiro256& operator=(Xoshiro256&& other) = default;
+
+    [[nodiscard]] static constexpr result_type min() {
+        return 0;
+    }
+
+    [[nodiscard]] static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    inline result_type operator()() {
+        const uint64_t result = RotateLeft(state_[1] * 5, 7) * 9;
+        const uint64_t shifted = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= shifted;
+        state_[3] = RotateLeft(state_[3], 45);
+        return result;
+    }
+
+    // The kStateWords words of the state, e.g. for a checkpoint.
+    [[nodiscard]] inline const uint64_t* GetState() const {
+        return state_;
+    }
+
+    void SetState(const uint64_t* state) {
+        std::copy(state, state + kStateWords, state_);
+    }
+
+    ~Xoshiro256() = default;
+};
+
+// Uniform in [start, finish]. Lemire's multiply-shift maps the upper 32 bits onto the range,
+// and the few products that would favour the low values are drawn again.
+int32_t GenerateInRange(int32_t start, int32_t finish, Xoshiro256& random) {
+    const auto width = static_cast<uint32_t>(finish - start) + 1;
+    uint64_t product = (random() >> 32) * width;
+    if (static_cast<uint32_t>(product) < width) {
+        const uint32_t threshold = (0U - width) % width;
+        while (static_cast<uint32_t>(product) < threshold) {
+            product = (random() >> 32) * width;
+        }
+    }
+    return start + static_cast<int32_t>(product >> 32);
+}
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+private:
+    int descriptor_;
+    size_t size_;
+    const char* data_;
+
+public:
+    explicit MappedFile(const std::string& filename):
+            descriptor_(-1),
+            size_(0),
+            data_(nullptr) {
+        descriptor_ = open(filename.c_str(), O_RDONLY);
+        if (descriptor_ < 0) {
+            throw std::runtime_error("Cannot open " + filename);
+        }
+
+        struct stat file_stat = {};
+        if (fstat(descriptor_, &file_stat) != 0) {
+            close(descriptor_);
+            throw std::runtime_error("Cannot stat " + filename);
+        }
+
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if (size_ == 0) {
+            return;
+        }
+
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor_, 0);
+        if (data == MAP_FAILED) {
+            close(descriptor_);
+            throw std::runtime_error("Cannot map " + filename);
+        }
+        madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+    }
+
+    MappedFile(const MappedFile& that) = delete;
+    MappedFile& operator=(const MappedFile& that) = delete;
+
+    [[nodiscard]] inline const char* Data() const {
+        return data_;
+    }
+
+    [[nodiscard]] inline size_t Size() const {
+        return size_;
+    }
+
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+        if (descriptor_ >= 0) {
+            close(descriptor_);
+        }
+    }
+};
+
+// Parses an unsigned decimal number at |cursor| skipping leading blanks.
+// Returns false if the line has no more numbers.
+inline bool ParseUnsigned(const char*& cursor, const char* end, uint32_t& value) {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t')) {
+        cursor++;
+    }
+
+    if (cursor == end || static_cast<unsigned char>(*cursor - '0') > 9) {
+        return false;
+    }
+
+    uint32_t result = 0;
+    while (cursor < end && static_cast<unsigned char>(*cursor - '0') <= 9) {
+        result = result * 10 + static_cast<uint32_t>(*cursor - '0');
+        cursor++;
+    }
+
+    value = result;
+    return true;
+}
+
+// Parses the rest of a DIMACS problem line, e.g. " edge 200 9876", after its 'p'.
+inline bool ParseProblemLine(const char*& cursor, const char* end, uint32_t& vertices, uint32_t& edges) {
+    // Skips the format word, e.g. "edge" or "col".
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t')) {
+        cursor++;
+    }
+    while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\n') {
+        cursor++;
+    }
+    return ParseUnsigned(cursor, end, vertices) && ParseUnsigned(cursor, end, edges);
+}
+
+// Calls |callback| with the command character of every line of [data, end) that is not blank,
+// the cursor after it and the end of the line, until it returns false. Leading blanks and the
+// '\r' of CRLF line ends are skipped, the next line is found before the callback parses any.
+template<typename F>
+void ForEachDimacsLine(const char* data, const char* end, F&& callback) {
+    const char* cursor = data;
+    while (cursor < end) {
+        const void* newline = std::memchr(cursor, '\n', end - cursor);
+        const char* line_end = newline != nullptr ? static_cast<const char*>(newline) : end;
+        const char* line = cursor;
+        cursor = newline != nullptr ? line_end + 1 : end;
+
+        while (line < line_end && (*line == ' ' || *line == '\t' || *line == '\r')) {
+            line++;
+        }
+        if (line != line_end && !callback(*line, line + 1, line_end)) {
+            return;
+        }
+    }
+}
+
+// Calls |callback| with every value of the sorted |one| that is also in the sorted |another|,
+// along with its position in |one|. Gallops through the longer range when one is much shorter,
+// merges otherwise.
+template<typename F>
+void IntersectSorted(const int32_t* one, size_t one_size, const int32_t* another, size_t another_size, F&& callback) {
+    constexpr size_t kGallopRatio = 8;
+
+    if (one_size * kGallopRatio < another_size) {
+        const int32_t* cursor = another;
+        const int32_t* end = another + another_size;
+        for (size_t i = 0; i < one_size && cursor != end; i++) {
+            size_t step = 1;
+            while (cursor + step < end && cursor[step] < one[i]) {
+                step *= 2;
+            }
+            cursor = std::lower_bound(cursor + step / 2, std::min(cursor + step + 1, end), one[i]);
+            if (cursor != end && *cursor == one[i]) {
+                callback(one[i], i);
+            }
+        }
+        return;
+    }
+
+    if (another_size * kGallopRatio < one_size) {
+        const int32_t* cursor = one;
+        const int32_t* end = one + one_size;
+        for (size_t i = 0; i < another_size && cursor != end; i++) {
+            size_t step = 1;
+            while (cursor + step < end && cursor[step] < another[i]) {
+                step *= 2;
+            }
+            cursor = std::lower_bound(cursor + step / 2, std::min(cursor + step + 1, end), another[i]);
+            if (cursor != end && *cursor == another[i]) {
+                callback(another[i], static_cast<size_t>(cursor - one));
+            }
+        }
+        return;
+    }
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < one_size && j < another_size) {
+        if (one[i] < another[j]) {
+            i++;
+        } else if (another[j] < one[i]) {
+            j++;
+        } else {
+            callback(one[i], i);
+            i++;
+            j++;
+        }
+    }
+}
+
+struct LoadStats {
+    size_t bytes = 0;
+    // Edge lines in the file, including repeated ones.
+    uint64_t edges = 0;
+    uint64_t unique_edges = 0;
+    double parse_seconds = 0;
+    double build_seconds = 0;
+    // Mapped from the binary cache instead of parsed.
+    bool from_cache = false;
+
+    [[nodiscard]] inline double MegabytesPerSecond() const {
+        return parse_seconds > 0 ? bytes / parse_seconds / (1024.0 * 1024.0) : 0.0;
+    }
+
+    [[nodiscard]] inline double EdgesPerSecond() const {
+        return parse_seconds > 0 ? edges / parse_seconds : 0.0;
+    }
+
+    [[nodiscard]] inline double Seconds() const {
+        return parse_seconds + build_seconds;
+    }
+};
+
+// Binary graph cache: a 64 byte header, then the degrees as uint32 padded to a cache line,
+// then the adjacency bitset rows. Everything is laid out to be used straight from a mapping.
+constexpr char kGraphCacheMagic[8] = { 'M', 'C', 'L', 'Q', 'B', 'I', 'N', '\0' };
+constexpr uint32_t kGraphCacheVersion = 1;
+constexpr uint32_t kGraphCacheLayoutRows = 0;
+const std::string kGraphCacheSuffix = ".mcb";
+
+struct GraphCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t layout;
+    uint64_t vertices;
+    uint64_t edges;
+    uint64_t row_words;
+    // The cache is stale once the source file changes.
+    uint64_t source_size;
+    int64_t source_mtime;
+    // Of everything after the header.
+    uint64_t checksum;
+};
+
+static_assert(sizeof(GraphCacheHeader) <= kCacheLineSize, "Cache header must fit in a cache line");
+
+inline size_t CacheDegreesBytes(size_t vertices) {
+    return (vertices * sizeof(uint32_t) + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+}
+
+inline int64_t ModificationTime(const struct stat& file_stat) {
+    return static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000LL + file_stat.st_mtim.tv_nsec;
+}
+
+// FNV-1a over 64-bit words.
+inline uint64_t HashWords(const uint64_t* words, size_t count, uint64_t hash = 14695981039346656037ULL) {
+    for (size_t i = 0; i < count; i++) {
+        hash = (hash ^ words[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+enum class GraphRepresentation {
+    // Hash set of neighbours per vertex.
+    kAdjacencyList,
+    // Word-packed bitset row per vertex, rows are cache-line aligned.
+    kAdjacencyMatrix,
+    // Sorted neighbour arrays packed one after another (compressed sparse rows).
+    kCsr,
+    // Matrix or CSR, picked by Graph::Load from the problem line of the file.
+    kAuto
+};
+
+std::string ToString(GraphRepresentation representation) {
+    switch (representation) {
+        case GraphRepresentation::kAdjacencyList:
+            return "list";
+        case GraphRepresentation::kAdjacencyMatrix:
+            return "matrix";
+        case GraphRepresentation::kCsr:
+            return "csr";
+        case GraphRepresentation::kAuto:
+            return "auto";
+    }
+    return "unknown";
+}
+
+// A bitset row operation costs |V| / 64 words and a neighbour array one costs the degree,
+// so graphs sparser than that go to CSR, as do the ones whose matrix would not fit.
+constexpr double kCsrMaxDensity = 1.0 / kWordBits;
+constexpr size_t kMatrixMaxBytes = size_t(1) << 30;
+
+class Graph {
+private:
+    size_t vertices_count_;
+    GraphRepresentation representation_;
+    std::vector<int32_t> vertices_;
+    std::unordered_map<int32_t, std::unordered_set<int32_t>> adjacency_list_;
+
+    size_t row_words_;
+    AlignedWords adjacency_matrix_;
+    // Either adjacency_matrix_ or the rows of a mapped cache file.
+    const uint64_t* matrix_rows_;
+    std::shared_ptr<const MappedFile> mapping_;
+    std::vector<uint32_t> degrees_;
+
+    // Sorted neighbours of vertex v are csr_neighbours_[csr_offsets_[v], csr_offsets_[v + 1]).
+    std::vector<uint64_t> csr_offsets_;
+    std::vector<int32_t> csr_neighbours_;
+
+    // Vertex weights, every vertex weighs 1 if empty.
+    std::vector<uint32_t> weights_;
+
+    [[nodiscard]] inline const int32_t* NeighboursBegin(int32_t vertex) const {
+        return csr_neighbours_.data() + csr_offsets_[vertex];
+    }
+
+    [[nodiscard]] inline const int32_t* NeighboursEnd(int32_t vertex) const {
+        return csr_neighbours_.data() + csr_offsets_[vertex + 1];
+    }
+
+    // Inserts |to| into the sorted neighbours of |from|, shifting everything after it.
+    // CSR is built for static graphs, so an edge change is linear in the edges.
+    bool InsertCsrNeighbour(int32_t from, int32_t to) {
+        const int32_t* position = std::lower_bound(NeighboursBegin(from), NeighboursEnd(from), to);
+        if (position != NeighboursEnd(from) && *position == to) {
+            return false;
+        }
+        csr_neighbours_.insert(csr_neighbours_.begin() + (position - csr_neighbours_.data()), to);
+        for (size_t v = from + 1; v < csr_offsets_.size(); v++) {
+            csr_offsets_[v] += 1;
+        }
+        return true;
+    }
+
+    bool EraseCsrNeighbour(int32_t from, int32_t to) {
+        const int32_t* position = std::lower_bound(NeighboursBegin(from), NeighboursEnd(from), to);
+        if (position == NeighboursEnd(from) || *position != to) {
+            return false;
+        }
+        csr_neighbours_.erase(csr_neighbours_.begin() + (position - csr_neighbours_.data()));
+        for (size_t v = from + 1; v < csr_offsets_.size(); v++) {
+            csr_offsets_[v] -= 1;
+        }
+        return true;
+    }
+
+    // Mapped rows are read-only, so they are copied before the first change.
+    void MakeMatrixWritable() {
+        if (mapping_ == nullptr) {
+            return;
+        }
+
+        adjacency_matrix_.assign(matrix_rows_, matrix_rows_ + row_words_ * vertices_count_);
+        matrix_rows_ = adjacency_matrix_.data();
+        mapping_.reset();
+    }
+
+    // Returns nullptr if the cache is missing, stale or corrupted.
+    static std::unique_ptr<Graph> ReadCacheFile(const std::string& filename,
+                                                const struct stat& source,
+                                                GraphRepresentation representation,
+                                                LoadStats* stats) {
+        struct stat cache_stat = {};
+        if (stat(filename.c_str(), &cache_stat) != 0 || cache_stat.st_size < static_cast<off_t>(kCacheLineSize)) {
+            return nullptr;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        auto mapping = std::make_shared<const MappedFile>(filename);
+        const auto* header = reinterpret_cast<const GraphCacheHeader*>(mapping->Data());
+
+        if (std::memcmp(header->magic, kGraphCacheMagic, sizeof(kGraphCacheMagic)) != 0 ||
+            header->version != kGraphCacheVersion ||
+            header->layout != kGraphCacheLayoutRows ||
+            header->source_size != static_cast<uint64_t>(source.st_size) ||
+            header->source_mtime != ModificationTime(source) ||
+            header->row_words != WordsForBits(header->vertices)) {
+            return nullptr;
+        }
+
+        const size_t vertices = header->vertices;
+        const size_t degrees_bytes = CacheDegreesBytes(vertices);
+        const size_t rows_words = header->row_words * vertices;
+        if (mapping->Size() != kCacheLineSize + degrees_bytes + rows_words * sizeof(uint64_t)) {
+            return nullptr;
+        }
+
+        const char* payload = mapping->Data() + kCacheLineSize;
+        const auto* payload_words = reinterpret_cast<const uint64_t*>(payload);
+        if (HashWords(payload_words, (degrees_bytes + rows_words * sizeof(uint64_t)) / sizeof(uint64_t)) !=
+            header->checksum) {
+            return nullptr;
+        }
+
+        const auto* degrees = reinterpret_cast<const uint32_t*>(payload);
+        const auto* rows = reinterpret_cast<const uint64_t*>(payload + degrees_bytes);
+
+        std::unique_ptr<Graph> graph = std::make_unique<Graph>(vertices, GraphRepresentation::kAdjacencyList);
+        const auto mapped = std::chrono::steady_clock::now();
+
+        if (representation == GraphRepresentation::kAdjacencyMatrix) {
+            graph->representation_ = GraphRepresentation::kAdjacencyMatrix;
+            graph->row_words_ = header->row_words;
+            graph->matrix_rows_ = rows;
+            graph->degrees_.assign(degrees, degrees + vertices);
+            graph->mapping_ = std::move(mapping);
+        } else {
+            for (size_t v = 0; v < vertices; v++) {
+                if (degrees[v] > 0) {
+                    graph->adjacency_list_[static_cast<int32_t>(v)].reserve(degrees[v]);
+                }
+            }
+            for (size_t v = 0; v < vertices; v++) {
+                ForEachBit(rows + header->row_words * v, header->row_words, [&](int32_t u) {
+                    if (u > static_cast<int32_t>(v)) {
+                        graph->AddEdge(static_cast<int32_t>(v), u);
+                    }
+                });
+            }
+        }
+
+        if (stats != nullptr) {
+            stats->bytes = static_cast<size_t>(cache_stat.st_size);
+            stats->edges = header->edges;
+            stats->unique_edges = header->edges;
+            stats->parse_seconds = std::chrono::duration<double>(mapped - start).count();
+            stats->build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mapped).count();
+            stats->from_cache = true;
+        }
+
+        return graph;
+    }
+
+public:
+    // Edges are packed as (min << 32) | max.
+    static inline uint64_t PackEdge(uint32_t from, uint32_t to) {
+        return from < to ? (static_cast<uint64_t>(from) << 32) | to : (static_cast<uint64_t>(to) << 32) | from;
+    }
+
+    // Parses a DIMACS file mapped into memory: the edge lines go straight into a buffer
+    // preallocated from the problem line, and the graph is built from the buffer in bulk.
+    static std::unique_ptr<Graph> ReadGraphFile(const std::string& filename,
+                                                GraphRepresentation representation = GraphRepresentation::kAdjacencyList,
+                                                LoadStats* stats = nullptr) {
+        const auto start = std::chrono::steady_clock::now();
+
+        MappedFile file(filename);
+
+        uint32_t vertices = 0;
+        uint32_t edges_count = 0;
+        bool has_problem_line = false;
+        std::vector<uint64_t> edges;
+
+        ForEachDimacsLine(file.Data(), file.Data() + file.Size(), [&](char command, const char* cursor, const char* end) {
+            if (command == 'e') {
+                uint32_t from = 0;
+                uint32_t to = 0;
+                if (!has_problem_line || !ParseUnsigned(cursor, end, from) || !ParseUnsigned(cursor, end, to) ||
+                    from == 0 || to == 0 || from > vertices || to > vertices) {
+                    throw std::runtime_error("Malformed edge line in " + filename);
+                }
+                edges.push_back(PackEdge(from - 1, to - 1));
+            } else if (command == 'p') {
+                if (!ParseProblemLine(cursor, end, vertices, edges_count)) {
+                    throw std::runtime_error("Malformed problem line in " + filename);
+                }
+                has_problem_line = true;
+                edges.reserve(edges_count);
+            }
+            return true;
+        });
+
+        if (!has_problem_line) {
+            throw std::runtime_error("No problem line in " + filename);
+        }
+
+        const auto parsed = std::chrono::steady_clock::now();
+        const uint64_t edges_in_file = edges.size();
+
+        std::unique_ptr<Graph> graph = FromEdges(vertices, edges, representation);
+
+        if (stats != nullptr) {
+            stats->bytes = file.Size();
+            stats->edges = edges_in_file;
+            stats->unique_edges = graph->EdgesCount();
+            stats->parse_seconds = std::chrono::duration<double>(parsed - start).count();
+            stats->build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parsed).count();
+        }
+
+        return graph;
+    }
+
+    // Matrix unless the problem line of |filename| describes a sparse or a huge graph.
+    static GraphRepresentation ChooseRepresentation(const std::string& filename) {
+        MappedFile file(filename);
+
+        bool has_problem_line = false;
+        GraphRepresentation representation = GraphRepresentation::kAdjacencyMatrix;
+        ForEachDimacsLine(file.Data(), file.Data() + file.Size(), [&](char command, const char* cursor, const char* end) {
+            if (command != 'p') {
+                return true;
+            }
+            uint32_t vertices = 0;
+            uint32_t edges = 0;
+            if (!ParseProblemLine(cursor, end, vertices, edges)) {
+                throw std::runtime_error("Malformed problem line in " + filename);
+            }
+            const double pairs = static_cast<double>(vertices) * (vertices - 1) / 2;
+            const double matrix_bytes = static_cast<double>(WordsForBits(vertices)) * vertices * sizeof(uint64_t);
+            if (matrix_bytes > kMatrixMaxBytes || (pairs > 0 && edges / pairs < kCsrMaxDensity)) {
+                representation = GraphRepresentation::kCsr;
+            }
+            has_problem_line = true;
+            return false;
+        });
+
+        if (has_problem_line) {
+            return representation;
+        }
+        throw std::runtime_error("No problem line in " + filename);
+    }
+
+    // Loads |filename| through its binary cache, which is written next to it on the first load
+    // and reused as long as the source file stays the same.
+    static std::unique_ptr<Graph> Load(const std::string& filename,
+                                       GraphRepresentation representation = GraphRepresentation::kAdjacencyList,
+                                       LoadStats* stats = nullptr,
+                                       bool use_cache = true) {
+        if (representation == GraphRepresentation::kAuto) {
+            representation = ChooseRepresentation(filename);
+        }
+        // The cache keeps bitset rows, which is what CSR is there to avoid.
+        if (!use_cache || representation == GraphRepresentation::kCsr) {
+            return ReadGraphFile(filename, representation, stats);
+        }
+
+        struct stat source = {};
+        if (stat(filename.c_str(), &source) != 0) {
+            throw std::runtime_error("Cannot stat " + filename);
+        }
+
+        const std::string cache_filename = filename + kGraphCacheSuffix;
+        std::unique_ptr<Graph> graph = ReadCacheFile(cache_filename, source, representation, stats);
+        if (graph != nullptr) {
+            return graph;
+        }
+
+        graph = ReadGraphFile(filename, representation, stats);
+        // A read-only data directory only costs the parse next time.
+        graph->WriteCacheFile(cache_filename, source);
+        return graph;
+    }
+
+    // Writes the graph in the binary cache format, |source| is the stat of the file it comes from.
+    bool WriteCacheFile(const std::string& filename, const struct stat& source) const {
+        GraphCacheHeader header = {};
+        std::memcpy(header.magic, kGraphCacheMagic, sizeof(kGraphCacheMagic));
+        header.version = kGraphCacheVersion;
+        header.layout = kGraphCacheLayoutRows;
+        header.vertices = vertices_count_;
+        header.edges = EdgesCount();
+        header.row_words = WordsForBits(vertices_count_);
+        header.source_size = static_cast<uint64_t>(source.st_size);
+        header.source_mtime = ModificationTime(source);
+
+        std::vector<uint32_t> degrees(CacheDegreesBytes(vertices_count_) / sizeof(uint32_t), 0);
+        AlignedWords rows(header.row_words * vertices_count_, 0);
+        for (int32_t v = 0; v < static_cast<int32_t>(vertices_count_); v++) {
+            degrees[v] = GetDegree(v);
+            uint64_t* row = rows.data() + header.row_words * v;
+            ForEachNeighbour(v, [&](int32_t n) {
+                row[n / kWordBits] |= 1ULL << (n % kWordBits);
+            });
+        }
+
+        header.checksum = HashWords(reinterpret_cast<const uint64_t*>(degrees.data()),
+                                    degrees.size() * sizeof(uint32_t) / sizeof(uint64_t));
+        header.checksum = HashWords(rows.data(), rows.size(), header.checksum);
+
+        // Written aside and renamed, so a concurrent reader never maps a half written file.
+        // The name is unique per process and thread, service workers may cache the same graph at once.
+        const std::string temporary_filename = filename + ".tmp" + std::to_string(getpid()) + "." +
+                                               std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        {
+            std::ofstream output(temporary_filename, std::ios::binary | std::ios::trunc);
+            char header_line[kCacheLineSize] = {};
+            std::memcpy(header_line, &header, sizeof(header));
+            output.write(header_line, sizeof(header_line));
+            output.write(reinterpret_cast<const char*>(degrees.data()),
+                         static_cast<std::streamsize>(degrees.size() * sizeof(uint32_t)));
+            output.write(reinterpret_cast<const char*>(rows.data()),
+                         static_cast<std::streamsize>(rows.size() * sizeof(uint64_t)));
+            if (!output) {
+                std::remove(temporary_filename.c_str());
+                return false;
+            }
+        }
+
+        if (std::rename(temporary_filename.c_str(), filename.c_str()) != 0) {
+            std::remove(temporary_filename.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Graph with the vertices relabelled: vertex v of the result is vertex |order|[v] of this one.
+    [[nodiscard]] std::unique_ptr<Graph> Permute(const std::vector<int32_t>& order) const {
+        std::vector<int32_t> new_ids(vertices_count_, 0);
+        for (size_t v = 0; v < order.size(); v++) {
+            new_ids[order[v]] = static_cast<int32_t>(v);
+        }
+
+        std::vector<uint64_t> edges;
+        edges.reserve(EdgesCount());
+        for (int32_t v = 0; v < static_cast<int32_t>(vertices_count_); v++) {
+            ForEachNeighbour(v, [&](int32_t n) {
+                if (v < n) {
+                    edges.push_back(PackEdge(new_ids[v], new_ids[n]));
+                }
+            });
+        }
+
+        std::unique_ptr<Graph> graph = FromEdges(vertices_count_, edges, representation_);
+        if (!weights_.empty()) {
+            std::vector<uint32_t> weights(vertices_count_, 0);
+            for (size_t v = 0; v < order.size(); v++) {
+                weights[v] = weights_[order[v]];
+            }
+            graph->SetWeights(std::move(weights));
+        }
+        return graph;
+    }
+
+    // Builds a graph from packed edges, which may repeat (DIMACS files do) and
+    // get reordered in place.
+    static std::unique_ptr<Graph> FromEdges(size_t vertices,
+                                            std::vector<uint64_t>& edges,
+                                            GraphRepresentation representation) {
+        std::unique_ptr<Graph> graph = std::make_unique<Graph>(vertices, representation);
+
+        if (representation == GraphRepresentation::kAdjacencyMatrix) {
+            // Repeated edges just set the same bits again.
+            for (const auto& edge: edges) {
+                const auto from = static_cast<uint32_t>(edge >> 32);
+                const auto to = static_cast<uint32_t>(edge);
+                if (from != to) {
+                    graph->adjacency_matrix_[graph->row_words_ * from + to / kWordBits] |= 1ULL << (to % kWordBits);
+                    graph->adjacency_matrix_[graph->row_words_ * to + from / kWordBits] |= 1ULL << (from % kWordBits);
+                }
+            }
+
+            for (size_t v = 0; v < vertices; v++) {
+                const uint64_t* row = graph->GetRow(static_cast<int32_t>(v));
+                uint32_t degree = 0;
+                for (size_t w = 0; w < graph->row_words_; w++) {
+                    degree += __builtin_popcountll(row[w]);
+                }
+                graph->degrees_[v] = degree;
+            }
+            return graph;
+        }
+
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        if (representation == GraphRepresentation::kCsr) {
+            auto& offsets = graph->csr_offsets_;
+            for (const auto& edge: edges) {
+                if ((edge >> 32) != static_cast<uint32_t>(edge)) {
+                    offsets[(edge >> 32) + 1] += 1;
+                    offsets[static_cast<uint32_t>(edge) + 1] += 1;
+                }
+            }
+            for (size_t v = 0; v < vertices; v++) {
+                offsets[v + 1] += offsets[v];
+            }
+
+            // Edges are sorted by the smaller end, so every vertex gets its smaller neighbours
+            // in order first, then its larger ones in order.
+            graph->csr_neighbours_.resize(offsets[vertices]);
+            std::vector<uint64_t> positions(offsets.begin(), offsets.end() - 1);
+            for (const auto& edge: edges) {
+                const auto from = static_cast<uint32_t>(edge >> 32);
+                const auto to = static_cast<uint32_t>(edge);
+                if (from != to) {
+                    graph->csr_neighbours_[positions[from]++] = static_cast<int32_t>(to);
+                    graph->csr_neighbours_[positions[to]++] = static_cast<int32_t>(from);
+                }
+            }
+            return graph;
+        }
+
+        std::vector<uint32_t> degrees(vertices, 0);
+        for (const auto& edge: edges) {
+            degrees[edge >> 32] += 1;
+            degrees[static_cast<uint32_t>(edge)] += 1;
+        }
+        for (size_t v = 0; v < vertices; v++) {
+            if (degrees[v] > 0) {
+                graph->adjacency_list_[static_cast<int32_t>(v)].reserve(degrees[v]);
+            }
+        }
+        for (const auto& edge: edges) {
+            const auto from = static_cast<int32_t>(edge >> 32);
+            const auto to = static_cast<int32_t>(static_cast<uint32_t>(edge));
+            if (from != to) {
+                graph->AddEdge(from, to);
+            }
+        }
+
+        return graph;
+    }
+
+    explicit Graph(size_t vertices_count,
+                   GraphRepresentation representation = GraphRepresentation::kAdjacencyList):
+            vertices_count_(vertices_count),
+            representation_(representation),
+            vertices_(),
+            adjacency_list_(),
+            row_words_(0),
+            adjacency_matrix_(),
+            matrix_rows_(nullptr),
+            mapping_(),
+            degrees_(),
+            csr_offsets_(),
+            csr_neighbours_(),
+            weights_() {
+        if (representation_ == GraphRepresentation::kAdjacencyMatrix) {
+            row_words_ = WordsForBits(vertices_count_);
+            adjacency_matrix_.assign(row_words_ * vertices_count_, 0);
+            matrix_rows_ = adjacency_matrix_.data();
+            degrees_.assign(vertices_count_, 0);
+        } else if (representation_ == GraphRepresentation::kCsr) {
+            csr_offsets_.assign(vertices_count_ + 1, 0);
+        }
+    }
+    Graph(const Graph& that):
+            vertices_count_(that.vertices_count_),
+            representation_(that.representation_),
+            vertices_(that.vertices_),
+            adjacency_list_(that.adjacency_list_),
+            row_words_(that.row_words_),
+            adjacency_matrix_(that.adjacency_matrix_),
+            matrix_rows_(that.mapping_ != nullptr ? that.matrix_rows_ : adjacency_matrix_.data()),
+            mapping_(that.mapping_),
+            degrees_(that.degrees_),
+            csr_offsets_(that.csr_offsets_),
+            csr_neighbours_(that.csr_neighbours_),
+            weights_(that.weights_) {
+        // empty on purpose
+    }
+    Graph& operator=(const Graph& that) {
+        if (this != &that) {
+            Graph copy(that);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    Graph(Graph&& that) = default;
+    Graph& operator=(Graph&& that) = default;
+
+    [[nodiscard]] inline bool HasEdge(int32_t from, int32_t to) const {
+        PROFILE_COUNT(kHasEdge, 1);
+        if (representation_ == GraphRepresentation::kAdjacencyMatrix) {
+            return (GetRow(from)[to / kWordBits] >> (to % kWordBits)) & 1ULL;
+        }
+        if (representation_ == GraphRepresentation::kCsr) {
+            if (GetDegree(from) > GetDegree(to)) {
+                std::swap(from, to);
+            }
+            return std::binary_search(NeighboursBegin(from), NeighboursEnd(from), to);
+        }
+
+        const auto& adjacent_to_from_vertexes = adjacency_list_.at(from);
+        const auto& adjacent_to_to_vertexes = adjacency_list_.at(to);
+
+        bool from_has_to = adjacent_to_from_vertexes.find(to) != adjacent_to_from_vertexes.end();
+        bool to_has_from = adjacent_to_to_vertexes.find(from) != adjacent_to_to_vertexes.end();
+        return from_has_to && to_has_from;
+    }
+
+    [[nodiscard]] inline std::vector<int32_t> GetVertices() {
+        if (vertices_.size() != vertices_count_) {
+            vertices_.clear();
+            if (representation_ != GraphRepresentation::kAdjacencyList) {
+                for (size_t v = 0; v < vertices_count_; v++) {
+                    vertices_.emplace_back(static_cast<int32_t>(v));
+                }
+            } else {
+                for (const auto& entry: adjacency_list_) {
+                    vertices_.emplace_back(entry.first);
+                }
+            }
+        }
+
+        return vertices_;
+    }
+
+    [[nodiscard]] inline uint32_t GetDegree(int32_t vertex) const {
+        if (representation_ == GraphRepresentation::kAdjacencyMatrix) {
+            return degrees_[vertex];
+        }
+        if (representation_ == GraphRepresentation::kCsr) {
+            return static_cast<uint32_t>(csr_offsets_[vertex + 1] - csr_offsets_[vertex]);
+        }
+
+        if (adjacency_list_.find(vertex) == adjacency_list_.end()) {
+            return 0;
+        }
+
+        return adjacency_list_.at(vertex).size();
+    }
+
+    // Only available for GraphRepresentation::kAdjacencyList.
+    [[nodiscard]] inline const std::unordered_set<int32_t>& GetAdjacentVertices(int32_t vertex) const {
+        if (adjacency_list_.find(vertex) == adjacency_list_.end()) {
+            return kEmptySet;
+        }
+
+        return adjacency_list_.at(vertex);
+    }
+
+    template<typename F>
+    inline void ForEachNeighbour(int32_t vertex, F&& callback) const {
+        if (representation_ == GraphRepresentation::kAdjacencyMatrix) {
+            ForEachBit(GetRow(vertex), row_words_, std::forward<F>(callback));
+            return;
+        }
+        if (representation_ == GraphRepresentation::kCsr) {
+            for (const int32_t* n = NeighboursBegin(vertex); n != NeighboursEnd(vertex); n++) {
+                callback(*n);
+            }
+            return;
+        }
+
+        const auto& it = adjacency_list_.find(vertex);
+        if (it == adjacency_list_.end()) {
+            return;
+        }
+
+        for (const auto& n: it->second) {
+            callback(n);
+        }
+    }
+
+    // Visits neighbours of |vertex| that belong to |vertices|.
+    template<typename F>
+    inline void ForEachNeighbourIn(int32_t vertex, const BitSet& vertices, F&& callback) const {
+        if (representation_ == GraphRepresentation::kAdjacencyMatrix) {
+            const uint64_t* row = GetRow(vertex);
+            const uint64_t* lookup = vertices.Data();
+
+            for (size_t w = 0; w < row_words_; w++) {
+                uint64_t word = row[w] & lookup[w];
+                while (word != 0) {
+                    callback(static_cast<int32_t>(w * kWordBits + __builtin_ctzll(word)));
+                    word &= word - 1;
+                }
+            }
+            return;
+        }
+
+        ForEachNeighbour(vertex, [&](int32_t n) {
+            if (vertices.Test(n)) {
+                callback(n);
+            }
+        });
+    }
+
+    // Visits every vertex other than |vertex| that is not adjacent to it.
+    template<typename F>
+    inline void ForEachNonNeighbour(int32_t vertex, F&& callback) const {
+        if (representation_ == GraphRepresentation::kAdjacencyMatrix) {
+            const uint64_t* row = GetRow(vertex);
+            size_t words_count = (vertices_count_ + kWordBits - 1) / kWordBits;
+
+            for (size_t w = 0; w < words_count; w++) {
+                uint64_t word = ~row[w];
+                if (w == words_count - 1 && vertices_count_ % kWordBits != 0) {
+                    word &= (1ULL << (vertices_count_ % kWordBits)) - 1;
+                }
+                if (w == vertex / kWordBits) {
+                    word &= ~(1ULL << (vertex % kWordBits));
+                }
+
+                while (word != 0) {
+                    callback(static_cast<int32_t>(w * kWordBits + __builtin_ctzll(word)));
+                    word &= word - 1;
+                }
+            }
+            return;
+        }
+
+        if (representation_ == GraphRepresentation::kCsr) {
+            const int32_t* n = NeighboursBegin(vertex);
+            const int32_t* end = NeighboursEnd(vertex);
+            for (int32_t v = 0; v < static_cast<int32_t>(vertices_count_); v++) {
+                if (n != end && *n == v) {
+                    n++;
+                } else if (v != vertex) {
+                    callback(v);
+                }
+            }
+            return;
+        }
+
+        const auto& neighbours = GetAdjacentVertices(vertex);
+        for (int32_t v = 0; v < static_cast<int32_t>(vertices_count_); v++) {
+            if (v != vertex && neighbours.find(v) == neighbours.end()) {
+                callback(v);
+            }
+        }
+    }
+
+    // Only available for GraphRepresentation::kAdjacencyMatrix.
+    [[nodiscard]] inline const uint64_t* GetRow(int32_t vertex) const {
+        return matrix_rows_ + row_words_ * vertex;
+    }
+
+    // Keeps in |vertices| only neighbours of |vertex|.
+    inline void IntersectNeighbourhood(int32_t vertex, BitSet& vertices) const {
+        if (representation_ == GraphRepresentation::kAdjacencyMatrix) {
+            vertices.And(GetRow(vertex));
+            return;
+        }
+        if (representation_ == GraphRepresentation::kCsr) {
+            // Merges the sorted neighbours into a mask word by word.
+            uint64_t* words = vertices.Data();
+            size_t word = 0;
+            uint64_t mask = 0;
+            for (const int32_t* n = NeighboursBegin(vertex); n != NeighboursEnd(vertex); n++) {
+                const size_t w = *n / kWordBits;
+                if (w != word) {
+                    words[word] &= mask;
+                    std::fill(words + word + 1, words + w, 0);
+                    word = w;
+                    mask = 0;
+                }
+                mask |= 1ULL << (*n % kWordBits);
+            }
+            if (vertices.WordsCount() > 0) {
+                words[word] &= mask;
+                std::fill(words + word + 1, words + vertices.WordsCount(), 0);
+            }
+            return;
+        }
+
+        vertices.ForEach([&](int32_t v) {
+            if (!HasEdge(vertex, v)) {
+                vertices.Reset(v);
+            }
+        });
+    }
+
+    // Amount of neighbours of |vertex| within |vertices|.
+    [[nodiscard]] inline uint32_t CountNeighboursIn(int32_t vertex, const BitSet& vertices) const {
+        if (representation_ == GraphRepresentation::kAdjacencyMatrix) {
+            return static_cast<uint32_t>(vertices.AndCount(GetRow(vertex)));
+        }
+
+        uint32_t count = 0;
+        if (representation_ == GraphRepresentation::kCsr) {
+            for (const int32_t* n = NeighboursBegin(vertex); n != NeighboursEnd(vertex); n++) {
+                count += vertices.Test(*n) ? 1 : 0;
+            }
+            return count;
+        }
+
+        vertices.ForEach([&](int32_t v) {
+            if (HasEdge(vertex, v)) {
+                count += 1;
+            }
+        });
+        return count;
+    }
+
+    [[nodiscard]] inline size_t Size() const {
+        return vertices_count_;
+    }
+
+    [[nodiscard]] size_t EdgesCount() const {
+        size_t degrees_sum = 0;
+        for (int32_t v = 0; v < static_cast<int32_t>(vertices_count_); v++) {
+            degrees_sum += GetDegree(v);
+        }
+        return degrees_sum / 2;
+    }
+
+    [[nodiscard]] inline GraphRepresentation GetRepresentation() const {
+        return representation_;
+    }
+
+    // One weight per vertex, all of them positive.
+    void SetWeights(std::vector<uint32_t> weights) {
+        if (weights.size() != vertices_count_ ||
+            std::find(weights.begin(), weights.end(), 0) != weights.end()) {
+            throw std::runtime_error("Expected a positive weight for each of " +
+                                     std::to_string(vertices_count_) + " vertices");
+        }
+        weights_ = std::move(weights);
+    }
+
+    [[nodiscard]] inline bool HasWeights() const {
+        return !weights_.empty();
+    }
+
+    [[nodiscard]] inline uint32_t GetWeight(int32_t vertex) const {
+        return weights_.empty() ? 1 : weights_[vertex];
+    }
+
+    // Total weight of |vertices|, their amount on an unweighted graph.
+    [[nodiscard]] size_t GetWeight(const std::vector<int32_t>& vertices) const {
+        if (weights_.empty()) {
+            return vertices.size();
+        }
+        size_t weight = 0;
+        for (const auto& v: vertices) {
+            weight += weights_[v];
+        }
+        return weight;
+    }
+
+    // Visits the vertices of the sorted |vertices| adjacent to |vertex| with their positions in it.
+    template<typename F>
+    inline void ForEachNeighbourAmong(int32_t vertex, const std::vector<int32_t>& vertices, F&& callback) const {
+        if (representation_ == GraphRepresentation::kCsr) {
+            IntersectSorted(vertices.data(), vertices.size(), NeighboursBegin(vertex), GetDegree(vertex),
+                            std::forward<F>(callback));
+            return;
+        }
+
+        for (size_t i = 0; i < vertices.size(); i++) {
+            if (HasEdge(vertex, vertices[i])) {
+                callback(vertices[i], i);
+            }
+        }
+    }
+
+    // Bytes held by the adjacency structure. For the list, hash nodes are counted as a value
+    // and a next pointer each, so it is a lower bound.
+    [[nodiscard]] size_t MemoryBytes() const {
+        switch (representation_) {
+            case GraphRepresentation::kAdjacencyMatrix:
+                return row_words_ * vertices_count_ * sizeof(uint64_t) + degrees_.size() * sizeof(uint32_t);
+            case GraphRepresentation::kCsr:
+                return csr_offsets_.size() * sizeof(uint64_t) + csr_neighbours_.size() * sizeof(int32_t);
+            default:
+                break;
+        }
+
+        size_t bytes = adjacency_list_.bucket_count() * sizeof(void*);
+        for (const auto& [vertex, neighbours]: adjacency_list_) {
+            bytes += sizeof(vertex) + sizeof(neighbours) + sizeof(void*);
+            bytes += neighbours.bucket_count() * sizeof(void*) + neighbours.size() * (sizeof(int32_t) + sizeof(void*));
+        }
+        return bytes;
+    }
+
+    // Returns false if the edge was already there, or is a loop.
+    bool AddEdge(int32_t from, int32_t to) {
+        if (representation_ == GraphRepresentation::kAdjacencyMatrix) {
+            if (from == to || HasEdge(from, to)) {
+                return false;
+            }
+
+            MakeMatrixWritable();
+            adjacency_matrix_[row_words_ * from + to / kWordBits] |= 1ULL << (to % kWordBits);
+            adjacency_matrix_[row_words_ * to + from / kWordBits] |= 1ULL << (from % kWordBits);
+            degrees_[from] += 1;
+            degrees_[to] += 1;
+            return true;
+        }
+        if (representation_ == GraphRepresentation::kCsr) {
+            if (from == to || !InsertCsrNeighbour(from, to)) {
+                return false;
+            }
+            InsertCsrNeighbour(to, from);
+            return true;
+        }
+
+        if (from == to) {
+            return false;
+        }
+        if (adjacency_list_.find(from) == adjacency_list_.end()) {
+            adjacency_list_[from] = {};
+        }
+        const bool is_added = adjacency_list_[from].insert(to).second;
+
+        if (adjacency_list_.find(to) == adjacency_list_.end()) {
+            adjacency_list_[to] = {};
+        }
+        adjacency_list_[to].insert(from);
+        return is_added;
+    }
+
+    // Returns false if there was no such edge.
+    bool RemoveEdge(int32_t from, int32_t to) {
+        if (representation_ == GraphRepresentation::kAdjacencyMatrix) {
+            if (!HasEdge(from, to)) {
+                return false;
+            }
+
+            MakeMatrixWritable();
+            adjacency_matrix_[row_words_ * from + to / kWordBits] &= ~(1ULL << (to % kWordBits));
+            adjacency_matrix_[row_words_ * to + from / kWordBits] &= ~(1ULL << (from % kWordBits));
+            degrees_[from] -= 1;
+            degrees_[to] -= 1;
+            return true;
+        }
+        if (representation_ == GraphRepresentation::kCsr) {
+            if (!EraseCsrNeighbour(from, to)) {
+                return false;
+            }
+            EraseCsrNeighbour(to, from);
+            return true;
+        }
+
+        const bool is_removed = adjacency_list_[from].erase(to) > 0;
+        adjacency_list_[to].erase(from);
+        return is_removed;
+    }
+
+
+    // [vertex, degree]
+    [[nodiscard]] std::vector<std::tuple<int32_t, uint32_t>> SortVerticesByDegree(
+            const std::unordered_set<int32_t>& vertices) const {
+        std::vector<std::tuple<int32_t, uint32_t>> result;
+
+        if (representation_ == GraphRepresentation::kAdjacencyMatrix) {
+            BitSet lookup(vertices_count_);
+            for (const auto& v: vertices) {
+                lookup.Set(v);
+            }
+
+            for (const auto& i: vertices) {
+                result.emplace_back(i, CountNeighboursIn(i, lookup));
+            }
+        } else {
+            for (const auto& i: vertices) {
+                uint32_t degree = 0;
+
+                for (const auto& j: vertices) {
+                    if (i == j) {
+                        continue;
+                    }
+
+                    if (HasEdge(i, j)) {
+                        degree += 1;
+                    }
+                }
+
+                result.emplace_back(i, degree);
+            }
+        }
+
+        std::sort(result.begin(), result.end(), [](const std::tuple<int32_t, uint32_t>& one,
+                                                   const std::tuple<int32_t, uint32_t>& another) {
+            return std::tie(std::get<1>(one), std::get<0>(one)) >
+                std::tie(std::get<1>(another), std::get<0>(another));
+        });
+
+        return result;
+    }
+
+
+    ~Graph() = default;
+};
+
+enum class WeightSource {
+    kNone,
+    // DIMACS "n <vertex> <weight>" lines of the graph file, or its sidecar file.
+    kFile,
+    // (v mod 200) + 1 for vertex v counted from 1, the usual weights of the weighted DIMACS benchmarks.
+    kSynthetic,
+};
+
+std::string ToString(WeightSource source) {
+    switch (source) {
+        case WeightSource::kNone:
+            return "none";
+        case WeightSource::kFile:
+            return "file";
+        case WeightSource::kSynthetic:
+            return "mod200";
+    }
+    throw std::runtime_error("Unknown weight source");
+}
+
+// Weights next to a graph file: one per line, vertex 1 first, '#' starts a comment.
+const std::string kWeightsSuffix = ".weights";
+
+// Weights of the |vertices| vertices of |filename| taken from |source|. The "n" lines of the graph
+// file win over the sidecar file, vertices without an "n" line weigh 1.
+std::vector<uint32_t> ReadVertexWeights(const std::string& filename, size_t vertices, WeightSource source) {
+    std::vector<uint32_t> weights(vertices, 1);
+    if (source == WeightSource::kSynthetic) {
+        for (size_t v = 0; v < vertices; v++) {
+            weights[v] = static_cast<uint32_t>((v + 1) % 200 + 1);
+        }
+        return weights;
+    }
+
+    MappedFile file(filename);
+    bool has_weights = false;
+    ForEachDimacsLine(file.Data(), file.Data() + file.Size(), [&](char command, const char* cursor, const char* end) {
+        if (command == 'n') {
+            uint32_t vertex = 0;
+            uint32_t weight = 0;
+            if (!ParseUnsigned(cursor, end, vertex) || !ParseUnsigned(cursor, end, weight) ||
+                vertex == 0 || vertex > vertices) {
+                throw std::runtime_error("Malformed weight line in " + filename);
+            }
+            weights[vertex - 1] = weight;
+            has_weights = true;
+        }
+        return true;
+    });
+    if (has_weights) {
+        return weights;
+    }
+
+    std::ifstream sidecar(filename + kWeightsSuffix);
+    if (!sidecar) {
+        throw std::runtime_error("No weight lines in " + filename + " and no " + filename + kWeightsSuffix);
+    }
+    size_t vertex = 0;
+    std::string line;
+    while (std::getline(sidecar, line)) {
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        if (vertex == vertices) {
+            throw std::runtime_error("More weights than vertices in " + filename + kWeightsSuffix);
+        }
+        weights[vertex++] = static_cast<uint32_t>(std::stoul(line));
+    }
+    if (vertex != vertices) {
+        throw std::runtime_error("Fewer weights than vertices in " + filename + kWeightsSuffix);
+    }
+    return weights;
+}
+
+struct CoreDecomposition {
+    // Vertices in the order they are peeled, the lowest core goes first.
+    std::vector<int32_t> order;
+    std::vector<uint32_t> cores;
+    uint32_t max_core = 0;
+};
+
+// Batagelj-Zaversnik bucket peeling, O(V + E).
+CoreDecomposition ComputeCoreDecomposition(const Graph& graph) {
+    const size_t size = graph.Size();
+
+    CoreDecomposition result;
+    result.order.assign(size, 0);
+    result.cores.assign(size, 0);
+
+    uint32_t max_degree = 0;
+    for (int32_t v = 0; v < static_cast<int32_t>(size); v++) {
+        result.cores[v] = graph.GetDegree(v);
+        max_degree = std::max(max_degree, result.cores[v]);
+    }
+
+    // bins[d] is the position of the first vertex with degree d in order.
+    std::vector<uint32_t> bins(max_degree + 1, 0);
+    std::vector<uint32_t> positions(size, 0);
+    for (int32_t v = 0; v < static_cast<int32_t>(size); v++) {
+        bins[result.cores[v]] += 1;
+    }
+    uint32_t start = 0;
+    for (auto& bin: bins) {
+        uint32_t count = bin;
+        bin = start;
+        start += count;
+    }
+    for (int32_t v = 0; v < static_cast<int32_t>(size); v++) {
+        positions[v] = bins[result.cores[v]]++;
+        result.order[positions[v]] = v;
+    }
+    for (uint32_t d = max_degree; d > 0; d--) {
+        bins[d] = bins[d - 1];
+    }
+    bins[0] = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        const int32_t v = result.order[i];
+        result.max_core = std::max(result.max_core, result.cores[v]);
+
+        graph.ForEachNeighbour(v, [&](int32_t u) {
+            if (result.cores[u] <= result.cores[v]) {
+                return;
+            }
+
+            // Swaps u with the first vertex of its bin and moves the bin border.
+            const uint32_t degree = result.cores[u];
+            const uint32_t u_position = positions[u];
+            const uint32_t w_position = bins[degree];
+            const int32_t w = result.order[w_position];
+            if (u != w) {
+                positions[u] = w_position;
+                positions[w] = u_position;
+                result.order[u_position] = w;
+                result.order[w_position] = u;
+            }
+            bins[degree] += 1;
+            result.cores[u] -= 1;
+        });
+    }
+
+    return result;
+}
+
+struct ReductionStats {
+    // Stage that removed the vertices, "degree" or "core".
+    std::string stage;
+    // Incumbent size the stage had to beat.
+    size_t clique_size = 0;
+    size_t vertices_removed = 0;
+    size_t edges_removed = 0;
+};
+
+// Removes vertices that cannot be in a clique larger than the incumbent: a vertex of such a clique
+// has at least |incumbent| neighbours, and sits in the |incumbent|-core. The degree stage drops
+// vertices short of neighbours in the remaining graph in one pass, the core stage drops the rest
+// using core numbers computed once in O(V + E). Both are re-applied every time the incumbent grows.
+class Reducer {
+private:
+    const Graph* graph_;
+    CoreDecomposition decomposition_;
+    BitSet active_;
+    // Degrees within the active vertices.
+    std::vector<uint32_t> degrees_;
+    size_t active_count_;
+    size_t clique_size_;
+    std::vector<ReductionStats> history_;
+
+    void Deactivate(int32_t vertex, ReductionStats& stats) {
+        active_.Reset(vertex);
+        active_count_ -= 1;
+        stats.vertices_removed += 1;
+
+        graph_->ForEachNeighbourIn(vertex, active_, [&](int32_t n) {
+            degrees_[n] -= 1;
+            stats.edges_removed += 1;
+        });
+    }
+
+public:
+    explicit Reducer(const Graph* graph):
+            graph_(graph),
+            decomposition_(ComputeCoreDecomposition(*graph)),
+            active_(graph->Size()),
+            degrees_(graph->Size(), 0),
+            active_count_(graph->Size()),
+            clique_size_(0),
+            history_() {
+        for (int32_t v = 0; v < static_cast<int32_t>(graph_->Size()); v++) {
+            active_.Set(v);
+            degrees_[v] = graph_->GetDegree(v);
+        }
+    }
+
+    Reducer(const Reducer& that) = default;
+    Reducer& operator=(const Reducer& that) = default;
+
+    // Keeps only vertices that may be in a clique larger than |clique_size|.
+    // Returns true if anything got removed.
+    bool Reduce(size_t clique_size) {
+        PROFILE_PHASE(kReduction);
+        if (clique_size <= clique_size_) {
+            return false;
+        }
+        clique_size_ = clique_size;
+
+        ReductionStats degree_stats;
+        degree_stats.stage = "degree";
+        degree_stats.clique_size = clique_size;
+        active_.ForEach([&](int32_t v) {
+            if (degrees_[v] < clique_size) {
+                Deactivate(v, degree_stats);
+            }
+        });
+
+        ReductionStats core_stats;
+        core_stats.stage = "core";
+        core_stats.clique_size = clique_size;
+        active_.ForEach([&](int32_t v) {
+            if (decomposition_.cores[v] < clique_size) {
+                Deactivate(v, core_stats);
+            }
+        });
+
+        history_.push_back(degree_stats);
+        history_.push_back(core_stats);
+        return degree_stats.vertices_removed + core_stats.vertices_removed > 0;
+    }
+
+    [[nodiscard]] inline const BitSet& GetActive() const {
+        return active_;
+    }
+
+    [[nodiscard]] inline size_t ActiveCount() const {
+        return active_count_;
+    }
+
+    [[nodiscard]] inline uint32_t GetMaxCore() const {
+        return decomposition_.max_core;
+    }
+
+    [[nodiscard]] inline const std::vector<ReductionStats>& GetHistory() const {
+        return history_;
+    }
+
+    ~Reducer() = default;
+};
+
+// DSatur colouring of an induced subgraph. Vertices are ranked by the amount of distinct colours
+// in their neighbourhood, then by their degree, then by id, the greatest is the best.
+//
+// All the state lives in flat arrays allocated once per graph, so the engine is meant to be reused
+// across calls. Once coloured, the vertex set can only shrink through Restrict, which keeps the
+// colours and updates the ranking incrementally instead of colouring from scratch.
+class ColoringEngine {
+public:
+    static constexpr size_t kMaxPickRank = 7;
+    // Lower ratios recolour less often but noticeably hurt gen200_* and brock400_* results.
+    static constexpr double kDefaultRecolorRatio = 0.95;
+
+private:
+    static constexpr int32_t kNoColor = -1;
+    static constexpr int32_t kNoVertex = -1;
+    // Picking from the top bucket scans it, which gets quadratic on large sparse sets where most
+    // vertices share a saturation, so from this size on a lazy heap picks instead.
+    static constexpr size_t kHeapMinMembers = 4096;
+
+    const Graph* graph_;
+
+    BitSet members_;
+    std::vector<int32_t> local_index_;
+    std::vector<int32_t> colors_;
+    size_t colors_count_;
+    size_t members_count_;
+    // Size of the set at the last colouring from scratch.
+    size_t colored_count_;
+
+    // Ranking keys.
+    std::vector<uint32_t> degrees_;
+    std::vector<uint32_t> distinct_colors_;
+    // Total weight of the neighbours in the set, only on a weighted graph.
+    std::vector<uint64_t> weighted_degrees_;
+    // [local index * colors_count_ + color] -> amount of neighbours with the color.
+    std::vector<uint32_t> color_counts_;
+
+    // DSatur queue: a doubly linked bucket per saturation value.
+    std::vector<uint32_t> saturation_;
+    std::vector<uint32_t> uncolored_degrees_;
+    std::vector<int32_t> bucket_heads_;
+    std::vector<int32_t> next_;
+    std::vector<int32_t> previous_;
+    // [saturation, uncoloured degree, vertex], entries with outdated keys are skipped when popped.
+    std::vector<std::tuple<uint32_t, uint32_t, int32_t>> heap_;
+    // [local index * seen_words_] -> bitset of colours already seen around the vertex.
+    std::vector<uint64_t> seen_colors_;
+    size_t seen_words_;
+
+    inline void PushToBucket(int32_t vertex) {
+        int32_t& head = bucket_heads_[saturation_[vertex]];
+        previous_[vertex] = kNoVertex;
+        next_[vertex] = head;
+        if (head != kNoVertex) {
+            previous_[head] = vertex;
+        }
+        head = vertex;
+    }
+
+    inline void RemoveFromBucket(int32_t vertex) {
+        if (previous_[vertex] != kNoVertex) {
+            next_[previous_[vertex]] = next_[vertex];
+        } else {
+            bucket_heads_[saturation_[vertex]] = next_[vertex];
+        }
+        if (next_[vertex] != kNoVertex) {
+            previous_[next_[vertex]] = previous_[vertex];
+        }
+    }
+
+    [[nodiscard]] inline bool IsRankedHigher(int32_t one, int32_t another) const {
+        if (!weighted_degrees_.empty()) {
+            // The heaviest vertex with its neighbourhood goes first, colours only break ties.
+            const uint64_t one_key = graph_->GetWeight(one) + weighted_degrees_[one];
+            const uint64_t another_key = graph_->GetWeight(another) + weighted_degrees_[another];
+            if (one_key != another_key) {
+                return one_key > another_key;
+            }
+        }
+        return std::tie(distinct_colors_[one], degrees_[one], one) >
+            std::tie(distinct_colors_[another], degrees_[another], another);
+    }
+
+    void CountNeighbourColors() {
+        color_counts_.assign(members_count_ * colors_count_, 0);
+
+        members_.ForEach([&](int32_t v) {
+            uint32_t* counts = color_counts_.data() + local_index_[v] * colors_count_;
+            uint32_t distinct = 0;
+
+            graph_->ForEachNeighbourIn(v, members_, [&](int32_t n) {
+                if (counts[colors_[n]]++ == 0) {
+                    distinct += 1;
+                }
+            });
+
+            distinct_colors_[v] = distinct;
+        });
+    }
+
+public:
+    explicit ColoringEngine(const Graph* graph):
+            graph_(graph),
+            members_(graph->Size()),
+            local_index_(graph->Size(), 0),
+            colors_(graph->Size(), kNoColor),
+            colors_count_(0),
+            members_count_(0),
+            colored_count_(0),
+            degrees_(graph->Size(), 0),
+            distinct_colors_(graph->Size(), 0),
+            weighted_degrees_(graph->HasWeights() ? graph->Size() : 0, 0),
+            color_counts_(),
+            saturation_(graph->Size(), 0),
+            uncolored_degrees_(graph->Size(), 0),
+            bucket_heads_(),
+            next_(graph->Size(), kNoVertex),
+            previous_(graph->Size(), kNoVertex),
+            heap_(),
+            seen_colors_(),
+            seen_words_(0) {
+        // empty on purpose
+    }
+
+    ColoringEngine(const ColoringEngine& that) = default;
+    ColoringEngine& operator=(const ColoringEngine& that) = default;
+
+    // Colours the subgraph induced by |vertices| from scratch.
+    void Color(const BitSet& vertices) {
+        PROFILE_PHASE(kColoring);
+        PROFILE_COUNT(kColorings, 1);
+        members_ = vertices;
+        members_count_ = 0;
+        colors_count_ = 0;
+
+        uint32_t max_degree = 0;
+        members_.ForEach([&](int32_t v) {
+            local_index_[v] = static_cast<int32_t>(members_count_++);
+            colors_[v] = kNoColor;
+            saturation_[v] = 0;
+            degrees_[v] = graph_->CountNeighboursIn(v, members_);
+            uncolored_degrees_[v] = degrees_[v];
+            max_degree = std::max(max_degree, degrees_[v]);
+            if (!weighted_degrees_.empty()) {
+                weighted_degrees_[v] = 0;
+                graph_->ForEachNeighbourIn(v, members_, [&](int32_t n) {
+                    weighted_degrees_[v] += graph_->GetWeight(n);
+                });
+            }
+        });
+
+        colored_count_ = members_count_;
+        if (members_count_ == 0) {
+            return;
+        }
+
+        // A vertex never sees more distinct colours than it has neighbours.
+        seen_words_ = (max_degree + kWordBits) / kWordBits;
+        seen_colors_.assign(members_count_ * seen_words_, 0);
+
+        // Both ways pick the greatest (saturation, uncoloured degree, vertex).
+        const bool is_heap = members_count_ >= kHeapMinMembers;
+        if (is_heap) {
+            heap_.clear();
+            members_.ForEach([&](int32_t v) {
+                heap_.emplace_back(0, uncolored_degrees_[v], v);
+            });
+            std::make_heap(heap_.begin(), heap_.end());
+        } else {
+            bucket_heads_.assign(max_degree + 1, kNoVertex);
+            members_.ForEach([&](int32_t v) {
+                PushToBucket(v);
+            });
+        }
+
+        uint32_t top_saturation = 0;
+        for (size_t step = 0; step < members_count_; step++) {
+            int32_t vertex = kNoVertex;
+            if (is_heap) {
+                while (vertex == kNoVertex) {
+                    std::pop_heap(heap_.begin(), heap_.end());
+                    const auto [saturation, uncolored_degree, v] = heap_.back();
+                    heap_.pop_back();
+                    if (colors_[v] == kNoColor && saturation == saturation_[v] &&
+                        uncolored_degree == uncolored_degrees_[v]) {
+                        vertex = v;
+                    }
+                }
+            } else {
+                while (bucket_heads_[top_saturation] == kNoVertex) {
+                    top_saturation -= 1;
+                }
+
+                vertex = bucket_heads_[top_saturation];
+                for (int32_t v = next_[vertex]; v != kNoVertex; v = next_[v]) {
+                    if (std::tie(uncolored_degrees_[v], v) > std::tie(uncolored_degrees_[vertex], vertex)) {
+                        vertex = v;
+                    }
+                }
+                RemoveFromBucket(vertex);
+            }
+
+            const uint64_t* seen = seen_colors_.data() + local_index_[vertex] * seen_words_;
+            int32_t color = 0;
+            for (size_t w = 0; w < seen_words_; w++) {
+                if (~seen[w] != 0) {
+                    color = static_cast<int32_t>(w * kWordBits + __builtin_ctzll(~seen[w]));
+                    break;
+                }
+            }
+
+            colors_[vertex] = color;
+            colors_count_ = std::max(colors_count_, static_cast<size_t>(color) + 1);
+
+            const uint64_t color_bit = 1ULL << (color % kWordBits);
+            graph_->ForEachNeighbourIn(vertex, members_, [&](int32_t n) {
+                if (colors_[n] != kNoColor) {
+                    return;
+                }
+
+                uncolored_degrees_[n] -= 1;
+
+                uint64_t& word = seen_colors_[local_index_[n] * seen_words_ + color / kWordBits];
+                if (is_heap) {
+                    if ((word & color_bit) == 0) {
+                        word |= color_bit;
+                        saturation_[n] += 1;
+                    }
+                    heap_.emplace_back(saturation_[n], uncolored_degrees_[n], n);
+                    std::push_heap(heap_.begin(), heap_.end());
+                } else if ((word & color_bit) == 0) {
+                    word |= color_bit;
+                    RemoveFromBucket(n);
+                    saturation_[n] += 1;
+                    PushToBucket(n);
+                    top_saturation = std::max(top_saturation, saturation_[n]);
+                }
+            });
+        }
+
+        CountNeighbourColors();
+    }
+
+    // Shrinks the coloured set to |vertices|, which must be a subset of the current one.
+    // The colouring stays proper, only the ranking keys of the survivors are updated.
+    void Restrict(const BitSet& vertices) {
+        PROFILE_PHASE(kColoring);
+        const uint64_t* keep = vertices.Data();
+        uint64_t* members = members_.Data();
+
+        for (size_t w = 0; w < members_.WordsCount(); w++) {
+            uint64_t removed = members[w] & ~keep[w];
+            members[w] &= keep[w];
+
+            while (removed != 0) {
+                int32_t vertex = static_cast<int32_t>(w * kWordBits + __builtin_ctzll(removed));
+                removed &= removed - 1;
+                members_count_ -= 1;
+
+                const int32_t color = colors_[vertex];
+                graph_->ForEachNeighbourIn(vertex, members_, [&](int32_t n) {
+                    degrees_[n] -= 1;
+                    if (!weighted_degrees_.empty()) {
+                        weighted_degrees_[n] -= graph_->GetWeight(vertex);
+                    }
+                    if (--color_counts_[local_index_[n] * colors_count_ + color] == 0) {
+                        distinct_colors_[n] -= 1;
+                    }
+                });
+            }
+        }
+    }
+
+    // Restricts the colouring to |vertices| while it is at least |min_ratio| of the set coloured
+    // from scratch last time, otherwise colours |vertices| from scratch: the inherited colouring
+    // drifts away from a DSatur one as the set shrinks and the ranking gets worse.
+    void Update(const BitSet& vertices, double min_ratio = kDefaultRecolorRatio) {
+        Restrict(vertices);
+        if (members_count_ < colored_count_ * min_ratio) {
+            Color(vertices);
+        }
+    }
+
+    // Returns the vertex at position |rank| of the ranking, or the last one if there are fewer vertices.
+    [[nodiscard]] int32_t PickVertex(size_t rank) const {
+        rank = std::min({ rank, members_count_ - 1, kMaxPickRank });
+
+        // Top rank + 1 vertices, the best goes first.
+        int32_t top[kMaxPickRank + 1];
+        size_t top_size = 0;
+
+        members_.ForEach([&](int32_t v) {
+            if (top_size == rank + 1 && !IsRankedHigher(v, top[rank])) {
+                return;
+            }
+
+            size_t position = std::min(top_size, rank);
+            while (position > 0 && IsRankedHigher(v, top[position - 1])) {
+                top[position] = top[position - 1];
+                position -= 1;
+            }
+            top[position] = v;
+            top_size = std::min(top_size + 1, rank + 1);
+        });
+
+        return top[rank];
+    }
+
+    [[nodiscard]] inline int32_t GetColor(int32_t vertex) const {
+        return colors_[vertex];
+    }
+
+    [[nodiscard]] inline size_t ColorsCount() const {
+        return colors_count_;
+    }
+
+    [[nodiscard]] inline size_t Size() const {
+        return members_count_;
+    }
+
+    ~ColoringEngine() = default;
+};
+
+class Clique {
+private:
+    Graph* graph_;
+
+    std::vector<int32_t> vertices_;
+    BitSet vertices_lookup_;
+
+    // Vertices adjacent to every clique member.
+    BitSet candidates_;
+    // Vertices adjacent to every clique member but one.
+    BitSet one_missing_;
+    // For every vertex, amount of clique members it is not adjacent to.
+    std::vector<uint32_t> missing_;
+    // Total weight of the members.
+    size_t weight_;
+
+    inline void IncreaseMissing(int32_t vertex) {
+        missing_[vertex] += 1;
+        if (missing_[vertex] == 1) {
+            candidates_.Reset(vertex);
+            one_missing_.Set(vertex);
+        } else if (missing_[vertex] == 2) {
+            one_missing_.Reset(vertex);
+        }
+    }
+
+    inline void DecreaseMissing(int32_t vertex) {
+        missing_[vertex] -= 1;
+        if (missing_[vertex] == 0) {
+            one_missing_.Reset(vertex);
+            candidates_.Set(vertex);
+        } else if (missing_[vertex] == 1) {
+            one_missing_.Set(vertex);
+        }
+    }
+
+public:
+    Clique(int32_t vertex,
+           Graph* graph):
+        graph_(graph),
+        vertices_(),
+        vertices_lookup_(graph->Size()),
+        candidates_(graph->Size()),
+        one_missing_(graph->Size()),
+        missing_(graph->Size(), 0),
+        weight_(0) {
+        Reset(vertex);
+    }
+
+    Clique(const Clique& that) = default;
+    Clique& operator=(const Clique& that) = default;
+
+    // Starts over from the single |vertex|, keeping the buffers.
+    void Reset(int32_t vertex) {
+        vertices_.assign(1, vertex);
+        vertices_lookup_.Clear();
+        vertices_lookup_.Set(vertex);
+        candidates_.Clear();
+        one_missing_.Clear();
+        std::fill(missing_.begin(), missing_.end(), 0);
+        weight_ = graph_->GetWeight(vertex);
+
+        graph_->ForEachNeighbour(vertex, [&](int32_t v) {
+            candidates_.Set(v);
+        });
+        graph_->ForEachNonNeighbour(vertex, [&](int32_t v) {
+            missing_[v] = 1;
+            one_missing_.Set(v);
+        });
+    }
+
+    [[nodiscard]] inline const std::vector<int32_t>& GetVertices() const {
+        return vertices_;
+    }
+
+    [[nodiscard]] inline const BitSet& GetCandidates() const {
+        return candidates_;
+    }
+
+    [[nodiscard]] inline const BitSet& GetOneMissing() const {
+        return one_missing_;
+    }
+
+    [[nodiscard]] inline bool IsCandidate(int32_t vertex) const {
+        return candidates_.Test(vertex);
+    }
+
+    [[nodiscard]] inline bool Contains(int32_t vertex) const {
+        return vertices_lookup_.Test(vertex);
+    }
+
+    // Amount of clique members |vertex| is not adjacent to.
+    [[nodiscard]] inline uint32_t GetMissing(int32_t vertex) const {
+        return missing_[vertex];
+    }
+
+    bool AddVertex(int32_t vertex) {
+        if (vertices_lookup_.Test(vertex)) {
+            return false;
+        }
+
+        vertices_.push_back(vertex);
+        vertices_lookup_.Set(vertex);
+        one_missing_.Reset(vertex);
+        weight_ += graph_->GetWeight(vertex);
+
+        // Candidates have no missing members, so a single row AND filters them,
+        // the counters of the rest are bumped through the non-neighbours only.
+#ifdef MAX_CLIQUE_PROFILE
+        const size_t candidates_before = candidates_.Count();
+#endif
+        graph_->IntersectNeighbourhood(vertex, candidates_);
+        PROFILE_COUNT(kCandidatesFiltered, candidates_before - candidates_.Count());
+        graph_->ForEachNonNeighbour(vertex, [&](int32_t v) {
+            if (!vertices_lookup_.Test(v)) {
+                IncreaseMissing(v);
+            }
+        });
+
+        return true;
+    }
+
+    bool RemoveVertex(int32_t vertex) {
+        if (!vertices_lookup_.Test(vertex)) {
+            return false;
+        }
+
+        vertices_.erase(
+                std::remove(vertices_.begin(), vertices_.end(), vertex), vertices_.end());
+        vertices_lookup_.Reset(vertex);
+        weight_ -= graph_->GetWeight(vertex);
+
+        // Every other clique member is adjacent to |vertex|, so only its non-neighbours change.
+        graph_->ForEachNonNeighbour(vertex, [&](int32_t v) {
+            if (!vertices_lookup_.Test(v)) {
+                DecreaseMissing(v);
+            }
+        });
+
+        // |vertex| is adjacent to all the remaining members.
+        candidates_.Set(vertex);
+
+        return true;
+    }
+
+    // Drops candidates outside |allowed|.
+    inline void RestrictCandidates(const BitSet& allowed) {
+#ifdef MAX_CLIQUE_PROFILE
+        const size_t candidates_before = candidates_.Count();
+#endif
+        candidates_.And(allowed.Data());
+        PROFILE_COUNT(kCandidatesFiltered, candidates_before - candidates_.Count());
+    }
+
+    [[nodiscard]] bool Verify() const {
+        std::unordered_set<int32_t> unique;
+
+        for (const auto& node: vertices_) {
+            unique.insert(node);
+        }
+
+        if (unique.size() != vertices_.size()) {
+            std::cout << "Duplicated vertices in the clique\n";
+            return false;
+        }
+
+        for (const auto& i: vertices_) {
+            for (const auto& j: vertices_) {
+                if (i != j && !graph_->HasEdge(i, j)) {
+                    std::cout << "Returned subgraph is not a clique\n";
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] inline bool IsNeededMoreCandidates() const {
+        return !candidates_.Empty();
+    }
+
+    [[nodiscard]] inline size_t CandidatesSize() const {
+        return candidates_.Count();
+    }
+
+    [[nodiscard]] inline size_t Size() const {
+        return vertices_.size();
+    }
+
+    // Same as Size() on an unweighted graph.
+    [[nodiscard]] inline size_t Weight() const {
+        return weight_;
+    }
+
+    ~Clique() = default;
+};
+
+// Multi-neighbourhood tabu search on a single clique, in the spirit of DLS-MC and MN/TS.
+//
+// Every vertex outside the clique keeps the amount of clique members it is not adjacent to,
+// so the add (0 missing) and swap (1 missing) neighbourhoods are kept as lists and a move only
+// touches the non-neighbours of the moved vertex. Removed vertices are tabu for a few moves,
+// and vertices that keep ending up in local optima are penalised so the walk leaves them.
+class TabuSearch {
+private:
+    static constexpr uint64_t kTabuTenure = 7;
+    // Penalties are decreased every kPenaltyDelay local optima.
+    static constexpr uint32_t kPenaltyDelay = 2;
+
+    // Vertex set with constant time insertion, removal and lookup.
+    class VertexList {
+    private:
+        std::vector<int32_t> items_;
+        std::vector<int32_t> positions_;
+
+    public:
+        explicit VertexList(size_t vertices):
+            items_(),
+            positions_(vertices, -1) {
+            items_.reserve(vertices);
+        }
+
+        inline void Insert(int32_t vertex) {
+            if (positions_[vertex] < 0) {
+                positions_[vertex] = static_cast<int32_t>(items_.size());
+                items_.push_back(vertex);
+            }
+        }
+
+        inline void Erase(int32_t vertex) {
+            const int32_t position = positions_[vertex];
+            if (position >= 0) {
+                items_[position] = items_.back();
+                positions_[items_[position]] = position;
+                items_.pop_back();
+                positions_[vertex] = -1;
+            }
+        }
+
+        [[nodiscard]] inline bool Contains(int32_t vertex) const {
+            return positions_[vertex] >= 0;
+        }
+
+        [[nodiscard]] inline const std::vector<int32_t>& Items() const {
+            return items_;
+        }
+    };
+
+    const Graph* graph_;
+    VertexList clique_;
+    VertexList add_;
+    VertexList swap_;
+    std::vector<uint32_t> missing_;
+    std::vector<uint64_t> tabu_until_;
+    std::vector<uint32_t> penalties_;
+    uint32_t local_optima_;
+    uint64_t moves_;
+    std::vector<int32_t> best_;
+    // Scratch of Perturb.
+    std::vector<int32_t> conflicts_;
+
+    void Add(int32_t vertex) {
+        add_.Erase(vertex);
+        swap_.Erase(vertex);
+        clique_.Insert(vertex);
+
+        graph_->ForEachNonNeighbour(vertex, [&](int32_t v) {
+            if (clique_.Contains(v)) {
+                return;
+            }
+            if (++missing_[v] == 1) {
+                add_.Erase(v);
+                swap_.Insert(v);
+            } else {
+                swap_.Erase(v);
+            }
+        });
+    }
+
+    void Remove(int32_t vertex) {
+        clique_.Erase(vertex);
+        tabu_until_[vertex] = moves_ + kTabuTenure;
+
+        // Every remaining member is adjacent to |vertex|.
+        missing_[vertex] = 0;
+        add_.Insert(vertex);
+
+        graph_->ForEachNonNeighbour(vertex, [&](int32_t v) {
+            if (clique_.Contains(v)) {
+                return;
+            }
+            const uint32_t missing = --missing_[v];
+            if (missing == 0) {
+                swap_.Erase(v);
+                add_.Insert(v);
+            } else if (missing == 1) {
+                swap_.Insert(v);
+            }
+        });
+    }
+
+    // Lowest penalty vertex of |list| that is allowed and not tabu, ties are broken at random.
+    [[nodiscard]] int32_t Select(const VertexList& list, const BitSet* allowed, Xoshiro256& random) const {
+        int32_t selected = -1;
+        uint32_t selected_penalty = 0;
+        int32_t ties = 0;
+
+        for (const auto& v: list.Items()) {
+            if (tabu_until_[v] > moves_ || (allowed != nullptr && !allowed->Test(v))) {
+                continue;
+            }
+
+            if (selected < 0 || penalties_[v] < selected_penalty) {
+                selected = v;
+                selected_penalty = penalties_[v];
+                ties = 1;
+            } else if (penalties_[v] == selected_penalty && GenerateInRange(0, ties++, random) == 0) {
+                selected = v;
+            }
+        }
+
+        return selected;
+    }
+
+    // The clique member |vertex| is not adjacent to.
+    [[nodiscard]] int32_t FindConflict(int32_t vertex) const {
+        for (const auto& v: clique_.Items()) {
+            if (!graph_->HasEdge(vertex, v)) {
+                return v;
+            }
+        }
+        throw std::runtime_error("Swap candidate has no conflict in the clique");
+    }
+
+    // Penalises the members of a local optimum and restarts the walk around a random vertex,
+    // keeping the members adjacent to it.
+    void Perturb(const BitSet* allowed, Xoshiro256& random) {
+        for (const auto& v: clique_.Items()) {
+            penalties_[v]++;
+        }
+        if (++local_optima_ % kPenaltyDelay == 0) {
+            for (auto& penalty: penalties_) {
+                if (penalty > 0) {
+                    penalty--;
+                }
+            }
+        }
+
+        int32_t vertex = GenerateInRange(0, static_cast<int32_t>(missing_.size()) - 1, random);
+        for (size_t attempt = 0; allowed != nullptr && !allowed->Test(vertex) && attempt < missing_.size(); attempt++) {
+            vertex = (vertex + 1) % static_cast<int32_t>(missing_.size());
+        }
+        if (clique_.Contains(vertex)) {
+            return;
+        }
+
+        conflicts_.clear();
+        for (const auto& v: clique_.Items()) {
+            if (!graph_->HasEdge(vertex, v)) {
+                conflicts_.push_back(v);
+            }
+        }
+        for (const auto& v: conflicts_) {
+            Remove(v);
+        }
+        Add(vertex);
+    }
+
+public:
+    explicit TabuSearch(const Graph* graph):
+        graph_(graph),
+        clique_(graph->Size()),
+        add_(graph->Size()),
+        swap_(graph->Size()),
+        missing_(graph->Size(), 0),
+        tabu_until_(graph->Size(), 0),
+        penalties_(graph->Size(), 0),
+        local_optima_(0),
+        moves_(0),
+        best_(),
+        conflicts_() {
+        conflicts_.reserve(graph->Size());
+        for (size_t v = 0; v < graph_->Size(); v++) {
+            add_.Insert(static_cast<int32_t>(v));
+        }
+    }
+
+    TabuSearch(const TabuSearch& that) = delete;
+    TabuSearch& operator=(const TabuSearch& that) = delete;
+
+    // Replaces the current clique with |vertices|.
+    void Reset(const std::vector<int32_t>& vertices) {
+        const auto current = clique_.Items();
+        for (const auto& v: current) {
+            Remove(v);
+        }
+        for (const auto& v: vertices) {
+            Add(v);
+        }
+        std::fill(tabu_until_.begin(), tabu_until_.end(), 0);
+        best_ = vertices;
+    }
+
+    // Makes |moves| moves: add a vertex if possible, otherwise swap one in for its only conflict,
+    // otherwise perturb. Only vertices in |allowed| are added. Returns true if the best clique grew.
+    // |on_local_optimum| gets every clique the walk gets stuck in, before it is perturbed. It is only
+    // maximal among the non-tabu vertices, a tabu one may still extend it.
+    bool Run(uint64_t moves,
+             const BitSet* allowed,
+             Xoshiro256& random,
+             const std::function<void(const std::vector<int32_t>&)>& on_local_optimum = {}) {
+        PROFILE_PHASE(kTabu);
+        bool improved = false;
+
+        for (uint64_t i = 0; i < moves; i++, moves_++) {
+            int32_t vertex = Select(add_, allowed, random);
+            if (vertex >= 0) {
+                Add(vertex);
+                if (clique_.Items().size() > best_.size()) {
+                    best_ = clique_.Items();
+                    improved = true;
+                }
+                continue;
+            }
+
+            vertex = Select(swap_, allowed, random);
+            if (vertex >= 0) {
+                Remove(FindConflict(vertex));
+                Add(vertex);
+                continue;
+            }
+
+            if (on_local_optimum) {
+                on_local_optimum(clique_.Items());
+            }
+            Perturb(allowed, random);
+        }
+
+        return improved;
+    }
+
+    [[nodiscard]] inline const std::vector<int32_t>& GetBest() const {
+        return best_;
+    }
+
+    [[nodiscard]] inline uint64_t MovesCount() const {
+        return moves_;
+    }
+
+    ~TabuSearch() = default;
+};
+
+// Incumbent improvement, |seconds| are counted from the start of the solve.
+struct TracePoint {
+    // "construction", "perturbation", "tabu" or "exact".
+    std::string phase;
+    double seconds = 0;
+    // Perturbation step of the worker that found the clique, or explored nodes for the exact search.
+    uint64_t iteration = 0;
+    size_t size = 0;
+};
+
+// Subproblems of an exact search left to explore, in the labels of the graph searched.
+struct ExactFrontier {
+    // Clique of every subproblem and the bitset words of its candidates.
+    std::vector<std::vector<int32_t>> cliques;
+    std::vector<std::vector<uint64_t>> candidates;
+    // Best clique found so far.
+    std::vector<int32_t> best;
+    uint64_t nodes = 0;
+};
+
+struct ExactOptions {
+    // Zero means no limit.
+    double time_limit = 0;
+    uint64_t nodes_limit = 0;
+    uint32_t threads = 1;
+    // Every |checkpoint_interval| seconds, and once more when a limit stops the search,
+    // the frontier goes to |on_checkpoint|. Zero disables checkpoints.
+    double checkpoint_interval = 0;
+    std::function<void(const ExactFrontier&)> on_checkpoint;
+};
+
+struct ExactStats {
+    uint64_t nodes = 0;
+    double seconds = 0;
+    // The search tree was fully explored, the clique is a maximum one.
+    bool is_optimal = false;
+    uint32_t threads = 1;
+    // Subproblems handed over to idle workers and taken by them.
+    uint64_t donated_tasks = 0;
+    uint64_t stolen_tasks = 0;
+
+    [[nodiscard]] inline double NodesPerSecond() const {
+        return seconds > 0 ? nodes / seconds : 0.0;
+    }
+};
+
+// Exact bitset branch and bound in the spirit of MCS/BBMC.
+//
+// Vertices are renumbered in degeneracy order, so the greedy sequential colouring of every node
+// meets the dense part of the graph first. A colour class number is an upper bound of the clique
+// size within the classes up to it: only vertices whose colour can still beat the incumbent are
+// branched on. Such vertices are first tried to be moved into a lower class (Re-NUMBER), then the
+// highest one is checked to be infra-chromatic, i.e. to not lift the bound even though it does not
+// fit in any class.
+//
+// The tree is explored by a pool of workers, every one with its own deque of subproblems. A worker
+// pops from the back of its deque and steals from the front of the others when it runs dry. While
+// any worker is idle, busy ones donate the branches they are about to descend into as a clique
+// plus a candidates bitset. The incumbent size is shared through an atomic, so every worker prunes
+// against the global best at once.
+//
+// For a checkpoint every worker copies its open subproblems the next time it enters a node: the
+// unexplored siblings on its path, the node itself and its queued tasks. Workers carry on right
+// after their copy, and a task stolen from a worker yet to copy by one that already has is added
+// by the thief, so nothing falls between the copies. Writing the frontier out is left to a
+// separate thread.
+//
+// On a weighted graph sizes are total weights, and the bound of a colour class is the sum of the
+// heaviest weight of every class up to it. Re-NUMBER and the infra-chromatic check count vertices,
+// so they are skipped there.
+class BranchAndBound {
+private:
+    struct Level {
+        BitSet candidates;
+        BitSet uncolored;
+        BitSet color_class;
+        // Colour classes that cannot beat the incumbent.
+        std::vector<BitSet> classes;
+        // Vertices to branch on, in non-decreasing colour order.
+        std::vector<int32_t> order;
+        // Bound of the clique weight within the classes up to the one of the vertex.
+        std::vector<size_t> colors;
+
+        explicit Level(size_t size):
+            candidates(size),
+            uncolored(size),
+            color_class(size),
+            classes(),
+            order(),
+            colors() {
+            // empty on purpose
+        }
+    };
+
+    struct Task {
+        std::vector<int32_t> clique;
+        BitSet candidates;
+    };
+
+    struct Worker {
+        std::vector<Level> levels;
+        std::vector<int32_t> current;
+        size_t current_weight = 0;
+        // Depth of the task being expanded, the levels above it belong to no path.
+        size_t base_depth = 0;
+        // Last checkpoint the worker copied its subproblems into, guarded by tasks_mutex.
+        uint64_t checkpoint_epoch = 0;
+        // Out of the search, guarded by checkpoint_mutex_.
+        bool is_finished = false;
+
+        std::mutex tasks_mutex;
+        std::deque<Task> tasks;
+
+        uint64_t nodes = 0;
+        uint64_t donated_tasks = 0;
+        uint64_t stolen_tasks = 0;
+    };
+
+    static constexpr uint64_t kInterruptCheckPeriod = 1024;
+
+    size_t size_;
+    size_t row_words_;
+    // Row per local vertex, local vertex i is original vertex labels_[i].
+    AlignedWords matrix_;
+    std::vector<int32_t> labels_;
+    // Weight per local vertex, empty on an unweighted graph.
+    std::vector<uint32_t> weights_;
+    // A clique never gets larger than the max core plus one.
+    size_t levels_count_;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::mutex best_mutex_;
+    std::vector<int32_t> best_;
+    size_t best_weight_;
+    std::atomic<size_t> best_size_;
+    std::vector<TracePoint> trace_;
+
+    // Tasks queued or being expanded, the search is over once it drops to zero.
+    std::atomic<int64_t> pending_tasks_;
+    std::atomic<uint32_t> idle_workers_;
+    std::atomic<uint64_t> nodes_;
+    std::atomic<bool> is_interrupted_;
+
+    ExactOptions options_;
+    ExactStats stats_;
+    std::chrono::steady_clock::time_point start_;
+    // Gets every clique larger than the bound in the original labels and returns the new bound.
+    std::function<size_t(const std::vector<int32_t>&)> on_clique_;
+    std::vector<int32_t> clique_labels_;
+
+    // Checkpoint in progress while |checkpoint_epoch_| is ahead of some worker's copy.
+    std::mutex checkpoint_mutex_;
+    std::condition_variable checkpoint_changed_;
+    std::atomic<uint64_t> checkpoint_epoch_;
+    // Workers yet to copy their subproblems into |checkpoint_tasks_|.
+    uint32_t checkpoint_pending_;
+    std::vector<Task> checkpoint_tasks_;
+    bool is_checkpoint_ready_;
+    // A limit was hit, the search stops once the last checkpoint is taken.
+    std::atomic<bool> is_stop_requested_;
+    bool is_search_over_;
+
+    [[nodiscard]] inline const uint64_t* GetRow(int32_t vertex) const {
+        return matrix_.data() + row_words_ * vertex;
+    }
+
+    [[nodiscard]] inline size_t GetWeight(int32_t vertex) const {
+        return weights_.empty() ? 1 : weights_[vertex];
+    }
+
+    [[nodiscard]] size_t GetWeight(const std::vector<int32_t>& vertices) const {
+        size_t weight = 0;
+        for (const auto& v: vertices) {
+            weight += GetWeight(v);
+        }
+        return weight;
+    }
+
+    // Amount of vertices of |set| adjacent to |vertex|, stops counting at 2.
+    // |neighbour| gets the last met one.
+    [[nodiscard]] inline uint32_t CountUpToTwo(int32_t vertex, const BitSet& set, int32_t& neighbour) const {
+        const uint64_t* row = GetRow(vertex);
+        const uint64_t* words = set.Data();
+
+        uint32_t count = 0;
+        for (size_t w = 0; w < row_words_; w++) {
+            uint64_t word = row[w] & words[w];
+            if (word == 0) {
+                continue;
+            }
+
+            count += __builtin_popcountll(word);
+            if (count >= 2) {
+                return count;
+            }
+            neighbour = static_cast<int32_t>(w * kWordBits + __builtin_ctzll(word));
+        }
+        return count;
+    }
+
+    [[nodiscard]] inline bool HasCommonNeighbour(int32_t one, int32_t another, const BitSet& set) const {
+        const uint64_t* one_row = GetRow(one);
+        const uint64_t* another_row = GetRow(another);
+        const uint64_t* words = set.Data();
+
+        for (size_t w = 0; w < row_words_; w++) {
+            if ((one_row[w] & another_row[w] & words[w]) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    [[nodiscard]] inline bool HasNeighbour(int32_t vertex, const BitSet& set) const {
+        const uint64_t* row = GetRow(vertex);
+        const uint64_t* words = set.Data();
+
+        for (size_t w = 0; w < row_words_; w++) {
+            if ((row[w] & words[w]) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Moves |vertex| into one of |classes|, possibly moving its only neighbour in the class to another one.
+    bool Renumber(int32_t vertex, std::vector<BitSet>& classes, size_t classes_count) const {
+        for (size_t i = 0; i < classes_count; i++) {
+            int32_t neighbour = -1;
+            uint32_t count = CountUpToTwo(vertex, classes[i], neighbour);
+            if (count == 0) {
+                classes[i].Set(vertex);
+                return true;
+            }
+            if (count > 1) {
+                continue;
+            }
+
+            for (size_t j = 0; j < classes_count; j++) {
+                if (j != i && !HasNeighbour(neighbour, classes[j])) {
+                    classes[i].Reset(neighbour);
+                    classes[i].Set(vertex);
+                    classes[j].Set(neighbour);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // True if no clique in |classes| plus |vertex| is larger than the amount of classes: for some class
+    // the vertex has a single neighbour w in it, and for another class it has no neighbour adjacent to w.
+    [[nodiscard]] bool IsInfraChromatic(int32_t vertex, const std::vector<BitSet>& classes, size_t classes_count) const {
+        for (size_t i = 0; i < classes_count; i++) {
+            int32_t neighbour = -1;
+            uint32_t count = CountUpToTwo(vertex, classes[i], neighbour);
+            if (count == 0) {
+                return true;
+            }
+            if (count > 1) {
+                continue;
+            }
+
+            for (size_t j = 0; j < classes_count; j++) {
+                if (j != i && !HasCommonNeighbour(vertex, neighbour, classes[j])) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Greedy sequential colouring of the level candidates. Only vertices with a colour large enough
+    // to beat the incumbent end up in level.order.
+    void ColorSort(Level& level, size_t clique_size) const {
+        const int64_t min_color = static_cast<int64_t>(best_size_.load(std::memory_order_relaxed)) -
+                                  static_cast<int64_t>(clique_size);
+        const size_t classes_count = static_cast<size_t>(std::max<int64_t>(0, min_color));
+
+        while (level.classes.size() < classes_count) {
+            level.classes.emplace_back(size_);
+        }
+
+        level.order.clear();
+        level.colors.clear();
+        level.uncolored = level.candidates;
+
+        uint64_t* uncolored = level.uncolored.Data();
+        uint64_t* color_class = level.color_class.Data();
+
+        size_t color = 0;
+        while (!level.uncolored.Empty()) {
+            color += 1;
+            level.color_class = level.uncolored;
+
+            BitSet* pruned_class = color <= classes_count ? &level.classes[color - 1] : nullptr;
+            if (pruned_class != nullptr) {
+                pruned_class->Clear();
+            }
+
+            for (size_t w = 0; w < row_words_; w++) {
+                while (color_class[w] != 0) {
+                    const int32_t v = static_cast<int32_t>(w * kWordBits + __builtin_ctzll(color_class[w]));
+                    const uint64_t bit = 1ULL << (v % kWordBits);
+                    uncolored[w] &= ~bit;
+                    color_class[w] &= ~bit;
+
+                    if (pruned_class != nullptr) {
+                        pruned_class->Set(v);
+                    } else if (classes_count > 0 && Renumber(v, level.classes, classes_count)) {
+                        // Re-NUMBER put v into a pruned class, so it does not block the current one.
+                        continue;
+                    } else {
+                        level.order.push_back(v);
+                        level.colors.push_back(static_cast<uint32_t>(color));
+                    }
+
+                    Kernels().and_not_words(color_class + w, GetRow(v) + w, row_words_ - w);
+                }
+            }
+        }
+
+        if (classes_count > 1 && !level.order.empty() &&
+            IsInfraChromatic(level.order.back(), level.classes, classes_count)) {
+            level.order.pop_back();
+            level.colors.pop_back();
+        }
+    }
+
+    // Greedy sequential colouring of the level candidates for a weighted graph. Classes whose
+    // bound cannot beat the incumbent stay out of level.order.
+    void ColorSortWeighted(Level& level, size_t clique_weight) const {
+        const size_t best_weight = best_size_.load(std::memory_order_relaxed);
+        const size_t min_bound = best_weight > clique_weight ? best_weight - clique_weight : 0;
+
+        level.order.clear();
+        level.colors.clear();
+        level.uncolored = level.candidates;
+
+        uint64_t* uncolored = level.uncolored.Data();
+        uint64_t* color_class = level.color_class.Data();
+
+        size_t bound = 0;
+        while (!level.uncolored.Empty()) {
+            level.color_class = level.uncolored;
+            const size_t first = level.order.size();
+            size_t heaviest = 0;
+
+            for (size_t w = 0; w < row_words_; w++) {
+                while (color_class[w] != 0) {
+                    const int32_t v = static_cast<int32_t>(w * kWordBits + __builtin_ctzll(color_class[w]));
+                    const uint64_t bit = 1ULL << (v % kWordBits);
+                    uncolored[w] &= ~bit;
+                    color_class[w] &= ~bit;
+
+                    level.order.push_back(v);
+                    heaviest = std::max(heaviest, GetWeight(v));
+                    Kernels().and_not_words(color_class + w, GetRow(v) + w, row_words_ - w);
+                }
+            }
+
+            bound += heaviest;
+            if (bound <= min_bound) {
+                level.order.resize(first);
+            } else {
+                level.colors.resize(level.order.size(), bound);
+            }
+        }
+    }
+
+    // Counts the node and checks the limits every kInterruptCheckPeriod nodes of the worker.
+    [[nodiscard]] bool IsInterrupted(Worker& worker) {
+        worker.nodes += 1;
+        if (worker.nodes % kInterruptCheckPeriod == 0) {
+            const uint64_t nodes = nodes_.fetch_add(kInterruptCheckPeriod, std::memory_order_relaxed) +
+                                   kInterruptCheckPeriod;
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+
+            if ((options_.nodes_limit > 0 && nodes >= options_.nodes_limit) ||
+                (options_.time_limit > 0 && elapsed.count() >= options_.time_limit)) {
+                if (!options_.on_checkpoint) {
+                    is_interrupted_.store(true, std::memory_order_relaxed);
+                } else if (!is_stop_requested_.exchange(true)) {
+                    std::lock_guard<std::mutex> lock(checkpoint_mutex_);
+                    StartCheckpoint();
+                }
+            }
+        }
+        return is_interrupted_.load(std::memory_order_relaxed);
+    }
+
+    // Must hold checkpoint_mutex_. Does nothing while a checkpoint is in progress.
+    void StartCheckpoint() {
+        if (checkpoint_pending_ > 0 || is_checkpoint_ready_) {
+            return;
+        }
+
+        checkpoint_tasks_.clear();
+        for (const auto& worker: workers_) {
+            if (!worker->is_finished) {
+                checkpoint_pending_ += 1;
+            }
+        }
+        checkpoint_epoch_.fetch_add(1, std::memory_order_release);
+        if (checkpoint_pending_ == 0) {
+            FinishCheckpoint();
+        }
+    }
+
+    // Must hold checkpoint_mutex_.
+    void FinishCheckpoint() {
+        is_checkpoint_ready_ = true;
+        if (is_stop_requested_.load()) {
+            is_interrupted_.store(true, std::memory_order_relaxed);
+        }
+        checkpoint_changed_.notify_all();
+    }
+
+    [[nodiscard]] inline bool IsCheckpointPending(const Worker& worker) const {
+        return options_.on_checkpoint && worker.checkpoint_epoch != checkpoint_epoch_.load(std::memory_order_acquire);
+    }
+
+    // Copies the open subproblems of |worker|, which is entering the node at |depth|, or is idle
+    // and has only its queue if |is_idle|.
+    void CopySubproblems(Worker& worker, size_t depth, bool is_idle) {
+        std::vector<Task> tasks;
+        for (size_t d = worker.base_depth; !is_idle && d <= depth; d++) {
+            Task task{ std::vector<int32_t>(worker.current.begin(), worker.current.begin() + d),
+                       worker.levels[d].candidates };
+            if (d < depth) {
+                // The subtree of current[d] is covered by the deeper levels.
+                task.candidates.Reset(worker.current[d]);
+            }
+            if (!task.candidates.Empty()) {
+                tasks.push_back(std::move(task));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(worker.tasks_mutex);
+            tasks.insert(tasks.end(), worker.tasks.begin(), worker.tasks.end());
+            worker.checkpoint_epoch = checkpoint_epoch_.load(std::memory_order_acquire);
+        }
+
+        std::lock_guard<std::mutex> lock(checkpoint_mutex_);
+        for (auto& task: tasks) {
+            checkpoint_tasks_.push_back(std::move(task));
+        }
+        if (--checkpoint_pending_ == 0) {
+            FinishCheckpoint();
+        }
+    }
+
+    // Takes |worker| out of the search, it holds no subproblems any more. Its queue is empty,
+    // so no thief reads its epoch.
+    void FinishWorker(Worker& worker) {
+        std::lock_guard<std::mutex> lock(checkpoint_mutex_);
+        worker.is_finished = true;
+        const uint64_t epoch = checkpoint_epoch_.load(std::memory_order_acquire);
+        if (worker.checkpoint_epoch != epoch) {
+            worker.checkpoint_epoch = epoch;
+            if (--checkpoint_pending_ == 0) {
+                FinishCheckpoint();
+            }
+        }
+    }
+
+    // Takes a checkpoint every interval until the search is over, and the last one when a limit stops it.
+    void RunCheckpoints() {
+        std::unique_lock<std::mutex> lock(checkpoint_mutex_);
+        auto next = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(options_.checkpoint_interval));
+        while (true) {
+            checkpoint_changed_.wait_until(lock, next, [&]() { return is_search_over_ || is_checkpoint_ready_; });
+            if (is_checkpoint_ready_) {
+                ExactFrontier frontier;
+                for (const auto& task: checkpoint_tasks_) {
+                    frontier.cliques.emplace_back();
+                    for (const auto& v: task.clique) {
+                        frontier.cliques.back().push_back(labels_[v]);
+                    }
+                    frontier.candidates.emplace_back(WordsForBits(size_), 0);
+                    task.candidates.ForEach([&](int32_t v) {
+                        frontier.candidates.back()[labels_[v] / kWordBits] |= 1ULL << (labels_[v] % kWordBits);
+                    });
+                }
+                checkpoint_tasks_.clear();
+                is_checkpoint_ready_ = false;
+                const bool is_last = is_stop_requested_.load();
+                lock.unlock();
+
+                {
+                    std::lock_guard<std::mutex> best_lock(best_mutex_);
+                    for (const auto& v: best_) {
+                        frontier.best.push_back(labels_[v]);
+                    }
+                }
+                frontier.nodes = nodes_.load(std::memory_order_relaxed);
+                options_.on_checkpoint(frontier);
+
+                lock.lock();
+                if (is_last) {
+                    // The stop may have come after this checkpoint was finished.
+                    is_interrupted_.store(true, std::memory_order_relaxed);
+                    return;
+                }
+                continue;
+            }
+            if (is_search_over_) {
+                return;
+            }
+            StartCheckpoint();
+            next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(options_.checkpoint_interval));
+        }
+    }
+
+    void UpdateBest(const Worker& worker) {
+        std::lock_guard<std::mutex> lock(best_mutex_);
+        if (on_clique_) {
+            clique_labels_.clear();
+            for (const auto& v: worker.current) {
+                clique_labels_.push_back(labels_[v]);
+            }
+            best_size_.store(on_clique_(clique_labels_), std::memory_order_relaxed);
+        }
+
+        if (worker.current_weight > best_weight_) {
+            best_ = worker.current;
+            best_weight_ = worker.current_weight;
+            if (!on_clique_) {
+                best_size_.store(best_weight_, std::memory_order_relaxed);
+            }
+
+            TracePoint point;
+            point.phase = "exact";
+            point.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+            point.iteration = nodes_.load(std::memory_order_relaxed) + worker.nodes % kInterruptCheckPeriod;
+            point.size = best_weight_;
+            trace_.push_back(point);
+        }
+    }
+
+    void PushTask(Worker& worker, const std::vector<int32_t>& clique, const BitSet& candidates) {
+        pending_tasks_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(worker.tasks_mutex);
+        worker.tasks.push_back(Task{ clique, candidates });
+    }
+
+    bool PopTask(Worker& worker, Task& task) {
+        std::lock_guard<std::mutex> lock(worker.tasks_mutex);
+        if (worker.tasks.empty()) {
+            return false;
+        }
+
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        return true;
+    }
+
+    bool StealTask(size_t thief, Task& task) {
+        for (size_t i = 1; i < workers_.size(); i++) {
+            Worker& victim = *workers_[(thief + i) % workers_.size()];
+
+            std::lock_guard<std::mutex> lock(victim.tasks_mutex);
+            if (victim.tasks.empty()) {
+                continue;
+            }
+
+            // The front holds the shallowest, i.e. the largest, subproblems.
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            workers_[thief]->stolen_tasks += 1;
+
+            // Neither the thief's copy nor the victim's would have it.
+            const uint64_t epoch = checkpoint_epoch_.load(std::memory_order_acquire);
+            if (workers_[thief]->checkpoint_epoch == epoch && victim.checkpoint_epoch != epoch) {
+                std::lock_guard<std::mutex> checkpoint_lock(checkpoint_mutex_);
+                checkpoint_tasks_.push_back(task);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void Expand(Worker& worker, size_t depth) {
+        if (IsInterrupted(worker)) {
+            return;
+        }
+        if (IsCheckpointPending(worker)) {
+            CopySubproblems(worker, depth, false);
+        }
+
+        Level& level = worker.levels[depth];
+        if (weights_.empty()) {
+            ColorSort(level, worker.current.size());
+        } else {
+            ColorSortWeighted(level, worker.current_weight);
+        }
+
+        for (size_t i = level.order.size(); i > 0; i--) {
+            if (worker.current_weight + level.colors[i - 1] <= best_size_.load(std::memory_order_relaxed)) {
+                return;
+            }
+
+            const int32_t v = level.order[i - 1];
+            worker.current.push_back(v);
+            worker.current_weight += GetWeight(v);
+
+            Level& next = worker.levels[depth + 1];
+            next.candidates = level.candidates;
+            next.candidates.And(GetRow(v));
+
+            if (next.candidates.Empty()) {
+                if (worker.current_weight > best_size_.load(std::memory_order_relaxed)) {
+                    UpdateBest(worker);
+                }
+            } else if (i > 1 && idle_workers_.load(std::memory_order_relaxed) > 0) {
+                // Siblings keep this worker busy, the branch goes to an idle one.
+                PushTask(worker, worker.current, next.candidates);
+                worker.donated_tasks += 1;
+            } else {
+                Expand(worker, depth + 1);
+            }
+
+            worker.current.pop_back();
+            worker.current_weight -= GetWeight(v);
+            level.candidates.Reset(v);
+
+            if (is_interrupted_.load(std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    void RunTask(Worker& worker, Task& task) {
+        const size_t depth = task.clique.size();
+        worker.base_depth = depth;
+        worker.current = std::move(task.clique);
+        worker.current_weight = GetWeight(worker.current);
+        worker.levels[depth].candidates = task.candidates;
+
+        Expand(worker, depth);
+        pending_tasks_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    void RunWorker(size_t index) {
+        Worker& worker = *workers_[index];
+        Task task;
+
+        while (!is_interrupted_.load(std::memory_order_relaxed)) {
+            if (PopTask(worker, task)) {
+                RunTask(worker, task);
+                continue;
+            }
+
+            idle_workers_.fetch_add(1, std::memory_order_relaxed);
+            bool has_task = false;
+            while (!is_interrupted_.load(std::memory_order_relaxed) &&
+                   pending_tasks_.load(std::memory_order_acquire) > 0) {
+                if (IsCheckpointPending(worker)) {
+                    CopySubproblems(worker, 0, true);
+                }
+                if (StealTask(index, task)) {
+                    has_task = true;
+                    break;
+                }
+                std::this_thread::yield();
+            }
+            idle_workers_.fetch_sub(1, std::memory_order_relaxed);
+
+            if (!has_task) {
+                break;
+            }
+            RunTask(worker, task);
+        }
+        FinishWorker(worker);
+    }
+
+public:
+    explicit BranchAndBound(const Graph& graph):
+            size_(graph.Size()),
+            row_words_(WordsForBits(graph.Size())),
+            matrix_(),
+            labels_(),
+            weights_(),
+            levels_count_(0),
+            workers_(),
+            best_mutex_(),
+            best_(),
+            best_weight_(0),
+            best_size_(0),
+            trace_(),
+            pending_tasks_(0),
+            idle_workers_(0),
+            nodes_(0),
+            is_interrupted_(false),
+            options_(),
+            stats_(),
+            start_(),
+            on_clique_(),
+            clique_labels_(),
+            checkpoint_mutex_(),
+            checkpoint_changed_(),
+            checkpoint_epoch_(0),
+            checkpoint_pending_(0),
+            checkpoint_tasks_(),
+            is_checkpoint_ready_(false),
+            is_stop_requested_(false),
+            is_search_over_(false) {
+        const CoreDecomposition decomposition = ComputeCoreDecomposition(graph);
+
+        // The last peeled vertex, which sits in the densest core, gets label 0.
+        labels_.assign(decomposition.order.rbegin(), decomposition.order.rend());
+        std::vector<int32_t> local(size_, 0);
+        for (size_t i = 0; i < size_; i++) {
+            local[labels_[i]] = static_cast<int32_t>(i);
+        }
+
+        matrix_.assign(row_words_ * size_, 0);
+        for (size_t i = 0; i < size_; i++) {
+            uint64_t* row = matrix_.data() + row_words_ * i;
+            graph.ForEachNeighbour(labels_[i], [&](int32_t n) {
+                row[local[n] / kWordBits] |= 1ULL << (local[n] % kWordBits);
+            });
+        }
+
+        if (graph.HasWeights()) {
+            weights_.resize(size_);
+            for (size_t i = 0; i < size_; i++) {
+                weights_[i] = graph.GetWeight(labels_[i]);
+            }
+        }
+
+        levels_count_ = decomposition.max_core + 3;
+    }
+
+    BranchAndBound(const BranchAndBound& that) = delete;
+    BranchAndBound& operator=(const BranchAndBound& that) = delete;
+
+    // Searches for a clique larger (heavier on a weighted graph) than |incumbent|, which must be
+    // a clique in the original labels, and than |min_size|. Returns the best clique found in the original labels, which is |incumbent|
+    // if there is no larger one.
+    // Only vertices of |allowed| are searched, if given.
+    // With |on_clique| every clique larger than the bound goes to it instead, and the bound starts
+    // at |min_size| and follows what it returns, so all the cliques above the final bound are met.
+    // With |resume| only its subproblems are searched, with its best clique as the incumbent if
+    // it is the larger one.
+    std::vector<int32_t> Solve(const std::vector<int32_t>& incumbent,
+                               const ExactOptions& options,
+                               const BitSet* allowed = nullptr,
+                               size_t min_size = 0,
+                               const std::function<size_t(const std::vector<int32_t>&)>& on_clique = {},
+                               const ExactFrontier* resume = nullptr) {
+        options_ = options;
+        on_clique_ = on_clique;
+        stats_ = ExactStats();
+        start_ = std::chrono::steady_clock::now();
+        pending_tasks_.store(0);
+        idle_workers_.store(0);
+        nodes_.store(0);
+        is_interrupted_.store(false);
+
+        std::vector<int32_t> local(size_, 0);
+        for (size_t i = 0; i < size_; i++) {
+            local[labels_[i]] = static_cast<int32_t>(i);
+        }
+
+        best_.clear();
+        for (const auto& v: incumbent) {
+            best_.push_back(local[v]);
+        }
+        best_weight_ = GetWeight(best_);
+        if (resume != nullptr) {
+            std::vector<int32_t> resumed;
+            for (const auto& v: resume->best) {
+                resumed.push_back(local[v]);
+            }
+            if (GetWeight(resumed) > best_weight_) {
+                best_ = std::move(resumed);
+                best_weight_ = GetWeight(best_);
+            }
+        }
+        best_size_.store(on_clique_ ? min_size : std::max(best_weight_, min_size));
+        trace_.clear();
+
+        const uint32_t threads_count = std::max(1U, options_.threads);
+        while (workers_.size() < threads_count) {
+            auto worker = std::make_unique<Worker>();
+            for (size_t i = 0; i < levels_count_; i++) {
+                worker->levels.emplace_back(size_);
+            }
+            workers_.push_back(std::move(worker));
+        }
+        workers_.resize(threads_count);
+        for (auto& worker: workers_) {
+            worker->nodes = 0;
+            worker->donated_tasks = 0;
+            worker->stolen_tasks = 0;
+            worker->tasks.clear();
+            worker->checkpoint_epoch = 0;
+            worker->is_finished = false;
+        }
+        checkpoint_epoch_.store(0);
+        checkpoint_pending_ = 0;
+        checkpoint_tasks_.clear();
+        is_checkpoint_ready_ = false;
+        is_stop_requested_.store(false);
+        is_search_over_ = false;
+
+        if (resume != nullptr) {
+            for (size_t t = 0; t < resume->cliques.size(); t++) {
+                std::vector<int32_t> clique;
+                for (const auto& v: resume->cliques[t]) {
+                    clique.push_back(local[v]);
+                }
+                BitSet candidates(size_);
+                ForEachBit(resume->candidates[t].data(), resume->candidates[t].size(), [&](int32_t v) {
+                    candidates.Set(local[v]);
+                });
+                // Spread over the workers, so they do not all start by stealing from the first.
+                PushTask(*workers_[t % threads_count], clique, candidates);
+            }
+        } else if (size_ > 0) {
+            BitSet root(size_);
+            for (size_t i = 0; i < size_; i++) {
+                if (allowed == nullptr || allowed->Test(labels_[i])) {
+                    root.Set(static_cast<int32_t>(i));
+                }
+            }
+            PushTask(*workers_.front(), {}, root);
+        }
+
+        std::thread checkpoints;
+        if (options_.on_checkpoint) {
+            checkpoints = std::thread([this]() {
+                RunCheckpoints();
+            });
+        }
+
+        if (pending_tasks_.load() > 0) {
+            if (threads_count == 1) {
+                RunWorker(0);
+            } else {
+                std::vector<std::thread> threads;
+                threads.reserve(threads_count);
+                for (size_t i = 0; i < threads_count; i++) {
+                    threads.emplace_back([this, i]() {
+                        RunWorker(i);
+                    });
+                }
+                for (auto& thread: threads) {
+                    thread.join();
+                }
+            }
+        }
+
+        if (checkpoints.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(checkpoint_mutex_);
+                is_search_over_ = true;
+            }
+            checkpoint_changed_.notify_all();
+            checkpoints.join();
+        }
+
+        stats_.is_optimal = !is_interrupted_.load();
+        stats_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        stats_.threads = threads_count;
+        for (const auto& worker: workers_) {
+            stats_.nodes += worker->nodes;
+            stats_.donated_tasks += worker->donated_tasks;
+            stats_.stolen_tasks += worker->stolen_tasks;
+        }
+
+        std::vector<int32_t> result;
+        for (const auto& v: best_) {
+            result.push_back(labels_[v]);
+        }
+        return result;
+    }
+
+    [[nodiscard]] inline const ExactStats& GetStats() const {
+        return stats_;
+    }
+
+    // Improvements of the last Solve, seconds are counted from its start.
+    [[nodiscard]] inline const std::vector<TracePoint>& GetTrace() const {
+        return trace_;
+    }
+
+    ~BranchAndBound() = default;
+};
+
+enum class Improver {
+    // Drops a random part of the clique and completes it again by the colouring.
+    kPerturbation,
+    // Add, swap and perturbation moves of the tabu search.
+    kTabu
+};
+
+std::string ToString(Improver improver) {
+    switch (improver) {
+        case Improver::kPerturbation:
+            return "perturbation";
+        case Improver::kTabu:
+            return "tabu";
+    }
+    return "unknown";
+}
+
+// When a perturbation worker drops its trajectory and builds a new one from a random vertex.
+enum class RestartPolicy {
+    // Never, every step perturbs the incumbent.
+    kNone,
+    // After runs of SearchOptions::restart_unit times 1, 1, 2, 1, 1, 2, 4, 1, ... steps.
+    kLuby,
+    // After runs growing by SearchOptions::restart_factor from SearchOptions::restart_unit steps.
+    kGeometric
+};
+
+std::string ToString(RestartPolicy policy) {
+    switch (policy) {
+        case RestartPolicy::kNone:
+            return "none";
+        case RestartPolicy::kLuby:
+            return "luby";
+        case RestartPolicy::kGeometric:
+            return "geometric";
+    }
+    return "unknown";
+}
+
+// Term |index| of the Luby sequence 1, 1, 2, 1, 1, 2, 4, 1, ..., counted from zero.
+uint64_t Luby(uint64_t index) {
+    // Finds the complete subsequence 1, ..., 2^power the term belongs to, then descends into its halves.
+    uint64_t size = 1;
+    uint32_t power = 0;
+    while (size < index + 1) {
+        power++;
+        size = 2 * size + 1;
+    }
+    while (size - 1 != index) {
+        size = (size - 1) / 2;
+        power--;
+        index %= size;
+    }
+    return 1ULL << power;
+}
+
+enum class VertexOrder {
+    // As in the file.
+    kOriginal,
+    // Highest core first, so the dense part of the graph is a prefix of every bitset.
+    kDegeneracy,
+    // By the colour of the initial DSatur colouring, largest degree first within a colour.
+    kColoring
+};
+
+std::string ToString(VertexOrder order) {
+    switch (order) {
+        case VertexOrder::kOriginal:
+            return "original";
+        case VertexOrder::kDegeneracy:
+            return "degeneracy";
+        case VertexOrder::kColoring:
+            return "coloring";
+    }
+    return "unknown";
+}
+
+// The largest distinct cliques met by the search, at most |capacity| of them. Cliques are kept
+// with sorted vertices and deduplicated by the hash of those. Two kept cliques share at most
+// |max_overlap| vertices: a clique that overlaps more with kept ones replaces them if it is larger
+// than all of them and is dropped otherwise. Safe to offer to from several threads.
+class CliquePool {
+public:
+    static constexpr size_t kNoOverlapLimit = std::numeric_limits<size_t>::max();
+
+private:
+    struct Entry {
+        std::vector<int32_t> vertices;
+        uint64_t hash;
+    };
+
+    size_t capacity_;
+    size_t max_overlap_;
+    // Min-heap by size, the smallest kept clique is at the front.
+    std::vector<Entry> entries_;
+    std::unordered_set<uint64_t> hashes_;
+    std::atomic<size_t> floor_;
+    uint64_t offered_;
+    uint64_t duplicates_;
+    mutable std::mutex mutex_;
+
+    static bool IsLarger(const Entry& one, const Entry& another) {
+        return one.vertices.size() > another.vertices.size();
+    }
+
+    // Shared vertices of two sorted cliques.
+    static size_t Overlap(const std::vector<int32_t>& one, const std::vector<int32_t>& another) {
+        size_t overlap = 0;
+        IntersectSorted(one.data(), one.size(), another.data(), another.size(), [&](int32_t, size_t) {
+            overlap += 1;
+        });
+        return overlap;
+    }
+
+public:
+    CliquePool(size_t capacity, size_t max_overlap):
+            capacity_(std::max<size_t>(1, capacity)),
+            max_overlap_(max_overlap),
+            entries_(),
+            hashes_(),
+            floor_(0),
+            offered_(0),
+            duplicates_(0),
+            mutex_() {
+        // empty on purpose
+    }
+
+    CliquePool(const CliquePool& that) = delete;
+    CliquePool& operator=(const CliquePool& that) = delete;
+
+    // Cliques not larger than this can not get in: zero until the pool is full,
+    // the size of its smallest clique after that.
+    [[nodiscard]] inline size_t GetFloor() const {
+        return floor_.load(std::memory_order_relaxed);
+    }
+
+    // |vertices| must be sorted. Returns true if the clique got in.
+    bool Offer(const std::vector<int32_t>& vertices) {
+        if (vertices.empty() || vertices.size() <= GetFloor()) {
+            return false;
+        }
+
+        uint64_t hash = 14695981039346656037ULL;
+        for (const auto& v: vertices) {
+            hash = (hash ^ static_cast<uint32_t>(v)) * 1099511628211ULL;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        offered_ += 1;
+        if (vertices.size() <= floor_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if (hashes_.count(hash) > 0) {
+            for (const auto& entry: entries_) {
+                if (entry.hash == hash && entry.vertices == vertices) {
+                    duplicates_ += 1;
+                    return false;
+                }
+            }
+        }
+
+        if (max_overlap_ != kNoOverlapLimit) {
+            bool is_removed = false;
+            for (const auto& entry: entries_) {
+                if (Overlap(entry.vertices, vertices) > max_overlap_ && entry.vertices.size() >= vertices.size()) {
+                    return false;
+                }
+            }
+            for (size_t i = entries_.size(); i > 0; i--) {
+                if (Overlap(entries_[i - 1].vertices, vertices) > max_overlap_) {
+                    hashes_.erase(entries_[i - 1].hash);
+                    entries_.erase(entries_.begin() + static_cast<std::ptrdiff_t>(i - 1));
+                    is_removed = true;
+                }
+            }
+            if (is_removed) {
+                std::make_heap(entries_.begin(), entries_.end(), IsLarger);
+            }
+        }
+
+        entries_.push_back(Entry{ vertices, hash });
+        std::push_heap(entries_.begin(), entries_.end(), IsLarger);
+        hashes_.insert(hash);
+        if (entries_.size() > capacity_) {
+            std::pop_heap(entries_.begin(), entries_.end(), IsLarger);
+            hashes_.erase(entries_.back().hash);
+            entries_.pop_back();
+        }
+        floor_.store(entries_.size() == capacity_ ? entries_.front().vertices.size() : 0, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Largest first, ties by their vertices.
+    [[nodiscard]] std::vector<std::vector<int32_t>> GetCliques() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::vector<int32_t>> cliques;
+        for (const auto& entry: entries_) {
+            cliques.push_back(entry.vertices);
+        }
+        std::sort(cliques.begin(), cliques.end(), [](const auto& one, const auto& another) {
+            return one.size() != another.size() ? one.size() > another.size() : one < another;
+        });
+        return cliques;
+    }
+
+    // Cliques offered above the size floor.
+    [[nodiscard]] inline uint64_t OfferedCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return offered_;
+    }
+
+    // Offered cliques that were already kept.
+    [[nodiscard]] inline uint64_t DuplicatesCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return duplicates_;
+    }
+
+    ~CliquePool() = default;
+};
+
+// Edges are given by the vertex labels of the file, counted from zero.
+struct EdgeBatch {
+    std::vector<std::pair<int32_t, int32_t>> insertions;
+    std::vector<std::pair<int32_t, int32_t>> deletions;
+};
+
+struct UpdateStats {
+    // Edges that actually changed.
+    size_t inserted = 0;
+    size_t deleted = 0;
+    // Incumbent vertices dropped because they lost an edge to another member.
+    size_t dropped = 0;
+    // Vertices moved to another colour because an inserted edge joined two of the same colour.
+    size_t recolored = 0;
+    size_t clique_size = 0;
+    double seconds = 0;
+};
+
+struct SearchOptions {
+    // Every worker runs its own perturbation trajectory.
+    uint32_t threads = 1;
+    uint64_t seed = 1;
+    // Budgets, the search stops at the first one exhausted. Zero means no limit, but at least
+    // one of iterations and time_limit must be set.
+    // Steps made by every worker: one perturbation or a batch of tabu moves.
+    uint64_t iterations = 130;
+    // Wall-clock seconds.
+    double time_limit = 0;
+    // Clique size (weight on a weighted graph) good enough to stop at.
+    size_t target_size = 0;
+    // Drop vertices that cannot be in a clique larger than the incumbent.
+    bool reduce = true;
+    Improver improver = Improver::kPerturbation;
+    // A perturbation completes the clique from a vertex drawn among the |rcl_width| best ranked
+    // candidates of the colouring, at most ColoringEngine::kMaxPickRank + 1.
+    uint32_t rcl_width = 2;
+    // Only for the perturbation, the tabu search keeps its own trajectory. Steps are counted per worker.
+    RestartPolicy restart = RestartPolicy::kLuby;
+    uint64_t restart_unit = 32;
+    double restart_factor = 1.5;
+    // Vertices are relabelled before the search, cliques are reported with the original labels.
+    VertexOrder order = VertexOrder::kOriginal;
+    // Continue from the current incumbent and colouring (kept up to date by ApplyUpdates)
+    // instead of constructing a clique from scratch.
+    bool warm_start = false;
+    // Collect the |top_k| largest distinct maximal cliques, sharing at most |max_overlap| vertices
+    // pairwise, instead of just the best one. The exact search adds to the same collection.
+    size_t top_k = 0;
+    size_t max_overlap = CliquePool::kNoOverlapLimit;
+    // Called on every incumbent improvement.
+    std::function<void(const TracePoint&)> on_improvement;
+};
+
+struct WorkerStats {
+    uint64_t iterations = 0;
+    // Tabu search moves, zero for the perturbation.
+    uint64_t moves = 0;
+    // New trajectories of SearchOptions::restart.
+    uint64_t restarts = 0;
+    double seconds = 0;
+
+    [[nodiscard]] inline double IterationsPerSecond() const {
+        return seconds > 0 ? iterations / seconds : 0.0;
+    }
+
+    [[nodiscard]] inline double MovesPerSecond() const {
+        return seconds > 0 ? moves / seconds : 0.0;
+    }
+};
+
+// Solver state to continue a search from, in the labels of the searched graph, i.e. after the
+// VertexOrder relabelling. The heuristic part is taken between rounds, where every worker starts
+// from the incumbent, so the random states and the step counter pick the run up where it was.
+struct Checkpoint {
+    static constexpr char kMagic[8] = { 'M', 'C', 'Q', 'C', 'K', 'P', 'T', '3' };
+
+    // What the run depends on, a checkpoint of another instance or configuration is refused.
+    uint64_t vertices = 0;
+    uint64_t edges = 0;
+    uint64_t seed = 0;
+    uint32_t threads = 0;
+    uint32_t order = 0;
+    uint32_t improver = 0;
+
+    // Steps of every worker done so far.
+    uint64_t steps = 0;
+    bool is_heuristic_done = false;
+    std::vector<int32_t> incumbent;
+    // Xoshiro256::kStateWords state words of the random generator of every worker, in worker order.
+    std::vector<uint64_t> random_states;
+    std::vector<uint64_t> worker_iterations;
+    // Clique every worker perturbs with SearchOptions::restart, empty without.
+    std::vector<std::vector<int32_t>> trajectories;
+    // Cliques of the pool with SearchOptions::top_k, in the file labels.
+    std::vector<std::vector<int32_t>> pool_cliques;
+
+    // Set once the exact search has started, its frontier is empty once it is over.
+    bool has_frontier = false;
+    ExactFrontier frontier;
+
+    [[nodiscard]] std::string Serialize() const {
+        std::string bytes(kMagic, sizeof(kMagic));
+        const auto put = [&bytes](uint64_t value) {
+            bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        };
+        const auto put_vector = [&](const auto& values) {
+            put(values.size());
+            bytes.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(values[0]));
+        };
+
+        put(vertices);
+        put(edges);
+        put(seed);
+        put(threads);
+        put(order);
+        put(improver);
+        put(steps);
+        put(is_heuristic_done ? 1 : 0);
+        put_vector(incumbent);
+        put_vector(random_states);
+        put_vector(worker_iterations);
+        put(trajectories.size());
+        for (const auto& trajectory: trajectories) {
+            put_vector(trajectory);
+        }
+        put(pool_cliques.size());
+        for (const auto& clique: pool_cliques) {
+            put_vector(clique);
+        }
+        put(has_frontier ? 1 : 0);
+        put(frontier.nodes);
+        put_vector(frontier.best);
+        put(frontier.cliques.size());
+        for (size_t i = 0; i < frontier.cliques.size(); i++) {
+            put_vector(frontier.cliques[i]);
+            put_vector(frontier.candidates[i]);
+        }
+        return bytes;
+    }
+
+    static Checkpoint Parse(const std::string& bytes) {
+        if (bytes.size() < sizeof(kMagic) || std::memcmp(bytes.data(), kMagic, sizeof(kMagic)) != 0) {
+            throw std::runtime_error("Not a checkpoint");
+        }
+
+        size_t position = sizeof(kMagic);
+        const auto take = [&](void* data, size_t size) {
+            if (bytes.size() - position < size) {
+                throw std::runtime_error("Truncated checkpoint");
+            }
+            std::memcpy(data, bytes.data() + position, size);
+            position += size;
+        };
+        const auto get = [&]() {
+            uint64_t value = 0;
+            take(&value, sizeof(value));
+            return value;
+        };
+        // Every counted item takes at least a byte, so a larger count is corrupted, not a reason to
+        // allocate.
+        const auto get_count = [&]() {
+            const uint64_t count = get();
+            if (count > bytes.size() - position) {
+                throw std::runtime_error("Corrupted checkpoint");
+            }
+            return count;
+        };
+        const auto get_vector = [&](auto& values) {
+            values.resize(get_count());
+            take(values.data(), values.size() * sizeof(values[0]));
+        };
+
+        Checkpoint checkpoint;
+        checkpoint.vertices = get();
+        checkpoint.edges = get();
+        checkpoint.seed = get();
+        checkpoint.threads = static_cast<uint32_t>(get());
+        checkpoint.order = static_cast<uint32_t>(get());
+        checkpoint.improver = static_cast<uint32_t>(get());
+        checkpoint.steps = get();
+        checkpoint.is_heuristic_done = get() != 0;
+        get_vector(checkpoint.incumbent);
+        get_vector(checkpoint.random_states);
+        get_vector(checkpoint.worker_iterations);
+        checkpoint.trajectories.resize(get_count());
+        for (auto& trajectory: checkpoint.trajectories) {
+            get_vector(trajectory);
+        }
+        checkpoint.pool_cliques.resize(get_count());
+        for (auto& clique: checkpoint.pool_cliques) {
+            get_vector(clique);
+        }
+        checkpoint.has_frontier = get() != 0;
+        checkpoint.frontier.nodes = get();
+        get_vector(checkpoint.frontier.best);
+        const uint64_t tasks = get_count();
+        for (uint64_t i = 0; i < tasks; i++) {
+            checkpoint.frontier.cliques.emplace_back();
+            get_vector(checkpoint.frontier.cliques.back());
+            checkpoint.frontier.candidates.emplace_back();
+            get_vector(checkpoint.frontier.candidates.back());
+        }
+        return checkpoint;
+    }
+};
+
+// On a weighted graph the incumbent is the heaviest clique, and the sizes the search compares,
+// bounds and reports are total weights. Reductions, the tabu search, the clique pool and the CSR
+// exact search count vertices, so they are not used there.
+class MaxCliqueProblem {
+private:
+    // Workers adopt the global incumbent every kStepsPerRound steps.
+    static constexpr int32_t kStepsPerRound = 10;
+    // Tabu search moves in a single step.
+    static constexpr uint64_t kTabuMovesPerStep = 1000;
+
+    // A worker's best clique grew within a round.
+    struct Improvement {
+        double seconds;
+        uint64_t iteration;
+        size_t size;
+    };
+
+    struct Worker {
+        Xoshiro256 random;
+        ColoringEngine coloring;
+        // Only for Improver::kTabu, keeps its own trajectory across the rounds.
+        std::unique_ptr<TabuSearch> tabu;
+        // Only with SearchOptions::restart, the clique perturbed instead of the incumbent. It moves
+        // to every candidate at least as large, and is rebuilt once |run_end| steps are done.
+        std::unique_ptr<Clique> trajectory;
+        uint64_t run;
+        uint64_t run_end;
+        std::unique_ptr<Clique> best_clique;
+        // Scratch state reused by every step, copies into it keep their buffers, so steps after
+        // the first few do not touch the heap.
+        std::unique_ptr<Clique> candidate;
+        std::vector<int32_t> clique_vertices;
+        std::vector<int32_t> to_remove;
+        std::vector<uint8_t> is_removed;
+        // Clique being offered to the pool.
+        std::vector<int32_t> offered;
+        WorkerStats stats;
+        // Every improvement of |best_clique| in the current round, in the order found.
+        std::vector<Improvement> improvements;
+
+        Worker(uint64_t seed, uint32_t index, const Graph* graph):
+            random(seed, index),
+            coloring(graph),
+            tabu(),
+            trajectory(),
+            run(0),
+            run_end(0),
+            best_clique(),
+            candidate(),
+            clique_vertices(),
+            to_remove(),
+            is_removed(graph->Size(), 0),
+            offered(),
+            stats(),
+            improvements() {
+            // empty on purpose
+        }
+    };
+
+    // Both may be shared with others, they are copied before the first edge update then.
+    std::shared_ptr<Graph> graph_;
+    // Graph as loaded, only kept once |graph_| is relabelled.
+    std::shared_ptr<Graph> original_graph_;
+    // Original label of every vertex of |graph_|, empty if it is not relabelled.
+    std::vector<int32_t> original_ids_;
+    VertexOrder order_;
+    std::unique_ptr<Clique> best_clique_;
+    std::vector<WorkerStats> workers_stats_;
+    ExactStats exact_stats_;
+    std::unique_ptr<Reducer> reducer_;
+    // Colouring and core bounds of the whole graph, the heuristic stops once it reaches them.
+    size_t upper_bound_;
+    // Proper colouring of the whole graph from the last construction, repaired on edge insertions.
+    std::vector<int32_t> colors_;
+    size_t colors_count_;
+    std::chrono::steady_clock::time_point solve_start_;
+    std::vector<TracePoint> trace_;
+    // Only with SearchOptions::top_k.
+    std::unique_ptr<CliquePool> pool_;
+    // Zero if checkpoints are off.
+    double checkpoint_interval_;
+    std::function<void(const Checkpoint&)> on_checkpoint_;
+    // Last heuristic checkpoint, the exact search adds its frontier to it.
+    Checkpoint checkpoint_;
+    // Picked up by the next FindClique and FindExactClique.
+    std::unique_ptr<Checkpoint> resume_;
+
+    // Cliques not larger than this are of no use: the incumbent, or the smallest clique of a full pool.
+    [[nodiscard]] inline size_t GetSizeFloor() const {
+        if (pool_ != nullptr) {
+            return pool_->GetFloor();
+        }
+        return best_clique_ != nullptr ? best_clique_->Weight() : 0;
+    }
+
+    // Upper bound from |colors_|: the amount of colours, or the sum of the heaviest weight of every colour.
+    [[nodiscard]] size_t GetColoringBound() const {
+        if (!graph_->HasWeights()) {
+            return colors_count_;
+        }
+        std::vector<uint32_t> heaviest(colors_count_, 0);
+        for (size_t v = 0; v < colors_.size(); v++) {
+            heaviest[colors_[v]] = std::max(heaviest[colors_[v]], graph_->GetWeight(static_cast<int32_t>(v)));
+        }
+        return std::accumulate(heaviest.begin(), heaviest.end(), size_t(0));
+    }
+
+    // Offers |vertices| to the pool in the file labels, extended to a maximal clique first unless
+    // |is_maximal|. Returns the size floor of the pool.
+    size_t Offer(const std::vector<int32_t>& vertices, bool is_maximal, std::vector<int32_t>& offered) const {
+        offered.assign(vertices.begin(), vertices.end());
+        if (!is_maximal && !offered.empty()) {
+            int32_t sparsest = offered.front();
+            for (const auto& v: offered) {
+                if (graph_->GetDegree(v) < graph_->GetDegree(sparsest)) {
+                    sparsest = v;
+                }
+            }
+            graph_->ForEachNeighbour(sparsest, [&](int32_t n) {
+                if (std::all_of(offered.begin(), offered.end(), [&](int32_t v) {
+                    return v != n && graph_->HasEdge(v, n);
+                })) {
+                    offered.push_back(n);
+                }
+            });
+        }
+        if (offered.size() > pool_->GetFloor()) {
+            if (!original_ids_.empty()) {
+                for (auto& v: offered) {
+                    v = original_ids_[v];
+                }
+            }
+            std::sort(offered.begin(), offered.end());
+            pool_->Offer(offered);
+        }
+        return pool_->GetFloor();
+    }
+
+    void AddTracePoint(const TracePoint& point, const SearchOptions* options) {
+        trace_.push_back(point);
+        if (options != nullptr && options->on_improvement) {
+            options->on_improvement(point);
+        }
+    }
+
+    [[nodiscard]] inline double SecondsSinceStart() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - solve_start_).count();
+    }
+
+    [[nodiscard]] std::unique_ptr<Clique> MakeClique(const std::vector<int32_t>& vertices) const {
+        std::unique_ptr<Clique> clique = std::make_unique<Clique>(vertices.front(), graph_.get());
+        for (const auto& v: vertices) {
+            clique->AddVertex(v);
+        }
+        return clique;
+    }
+
+    // Adds the best ranked candidates until the clique is maximal. Candidate is picked among
+    // the top |ranks| of the colouring, or the top one if |random| is not given.
+    void Complete(Clique& clique, ColoringEngine& coloring, Xoshiro256* random, int32_t ranks) const {
+        PROFILE_PHASE(kRebuild);
+        coloring.Color(clique.GetCandidates());
+        while (clique.IsNeededMoreCandidates()) {
+            const auto& index = random != nullptr ? GenerateInRange(0, ranks - 1, *random) : 0;
+            const auto& candidate = coloring.PickVertex(index);
+            clique.AddVertex(candidate);
+            // Candidates only shrink while the clique grows, so the colouring is mostly restricted, not rebuilt.
+            coloring.Update(clique.GetCandidates());
+        }
+    }
+
+    // Removes up to 70% of the clique at random and completes it again from the top |ranks|.
+    void Perturb(Clique& clique, Worker& worker, int32_t ranks) const {
+        PROFILE_PHASE(kPerturbation);
+        auto& clique_vertices = worker.clique_vertices;
+        clique_vertices.assign(clique.GetVertices().begin(), clique.GetVertices().end());
+        const auto last = static_cast<int32_t>(clique_vertices.size()) - 1;
+
+        auto& to_remove = worker.to_remove;
+        to_remove.clear();
+        to_remove.push_back(GenerateInRange(0, last, worker.random));
+        worker.is_removed[to_remove.back()] = 1;
+
+        int32_t max_amount_to_remove = std::max(1, static_cast<int32_t>(clique.Size() * 0.7));
+
+        // Starts from 1 as we already removed one.
+        for (int32_t amount_to_remove = 1; amount_to_remove < max_amount_to_remove; amount_to_remove++) {
+            int32_t new_vertex = GenerateInRange(0, last, worker.random);
+            while (worker.is_removed[new_vertex]) {
+                new_vertex = GenerateInRange(0, last, worker.random);
+            }
+
+            to_remove.push_back(new_vertex);
+            worker.is_removed[new_vertex] = 1;
+        }
+
+        // The resulting clique does not depend on the removal order.
+        for (const auto& vri: to_remove) {
+            worker.is_removed[vri] = 0;
+            if (!clique.RemoveVertex(clique_vertices[vri])) {
+                throw std::runtime_error("Trying to remove vertex that is not in clique");
+            }
+        }
+
+        if (reducer_ != nullptr) {
+            clique.RestrictCandidates(reducer_->GetActive());
+        }
+
+        Complete(clique, worker.coloring, &worker.random, ranks);
+    }
+
+    // Builds a new trajectory into |clique| from a vertex drawn uniformly among the active ones.
+    void Restart(Clique& clique, Worker& worker, int32_t ranks) const {
+        int32_t vertex = GenerateInRange(0, static_cast<int32_t>(graph_->Size()) - 1, worker.random);
+        if (reducer_ != nullptr && !reducer_->GetActive().Test(vertex)) {
+            int32_t rank = GenerateInRange(0, static_cast<int32_t>(reducer_->ActiveCount()) - 1, worker.random);
+            reducer_->GetActive().ForEach([&](int32_t v) {
+                if (rank-- == 0) {
+                    vertex = v;
+                }
+            });
+        }
+
+        clique.Reset(vertex);
+        if (reducer_ != nullptr) {
+            clique.RestrictCandidates(reducer_->GetActive());
+        }
+        Complete(clique, worker.coloring, &worker.random, ranks);
+    }
+
+    [[nodiscard]] static uint64_t GetRunLength(const SearchOptions& options, uint64_t run) {
+        if (options.restart == RestartPolicy::kLuby) {
+            return options.restart_unit * Luby(run);
+        }
+        const double length = static_cast<double>(options.restart_unit) * std::pow(options.restart_factor, run);
+        return static_cast<uint64_t>(std::clamp(length, 1.0, 1e18));
+    }
+
+    // Places |worker| in the restart schedule after the steps it has made.
+    static void StartRuns(Worker& worker, const SearchOptions& options) {
+        worker.run = 0;
+        worker.run_end = GetRunLength(options, 0);
+        while (worker.run_end <= worker.stats.iterations) {
+            worker.run += 1;
+            worker.run_end += GetRunLength(options, worker.run);
+        }
+    }
+
+    // Takes the heuristic checkpoint after |steps| steps of every worker.
+    void SaveCheckpoint(const std::vector<Worker>& workers, uint64_t steps, bool is_done) {
+        checkpoint_.steps = steps;
+        checkpoint_.is_heuristic_done = is_done;
+        checkpoint_.incumbent = best_clique_->GetVertices();
+        checkpoint_.random_states.clear();
+        checkpoint_.worker_iterations.clear();
+        checkpoint_.trajectories.clear();
+        for (const auto& worker: workers) {
+            const uint64_t* state = worker.random.GetState();
+            checkpoint_.random_states.insert(checkpoint_.random_states.end(), state, state + Xoshiro256::kStateWords);
+            checkpoint_.worker_iterations.push_back(worker.stats.iterations);
+            checkpoint_.trajectories.push_back(worker.trajectory != nullptr ? worker.trajectory->GetVertices() :
+                                                                             std::vector<int32_t>());
+        }
+        checkpoint_.pool_cliques = GetTopCliques();
+        checkpoint_.has_frontier = false;
+        checkpoint_.frontier = ExactFrontier();
+        on_checkpoint_(checkpoint_);
+    }
+
+    // Publishes the improvements of |worker| to |best_size|, the best size any worker has reached.
+    // Stops early once its own clique is |stop_size|, so the round only depends on its own trajectory.
+    void RunWorker(Worker& worker,
+                   const SearchOptions& options,
+                   uint64_t steps,
+                   std::atomic<size_t>& best_size,
+                   size_t stop_size,
+                   const std::chrono::steady_clock::time_point* deadline) const {
+        const auto ranks = static_cast<int32_t>(std::max(1U, options.rcl_width));
+        const auto start = std::chrono::steady_clock::now();
+#ifdef MAX_CLIQUE_PROFILE
+        // The first round sizes the scratch buffers, later ones are expected not to allocate.
+        const bool is_steady = worker.stats.iterations > 0;
+        const uint64_t allocations_before = Profiler::ThreadAllocations();
+#endif
+
+        uint64_t step = 0;
+        for (; step < steps; step++) {
+            if (worker.best_clique->Weight() >= stop_size ||
+                (deadline != nullptr && std::chrono::steady_clock::now() >= *deadline)) {
+                break;
+            }
+
+            if (worker.tabu != nullptr) {
+                const BitSet* allowed = reducer_ != nullptr ? &reducer_->GetActive() : nullptr;
+                if (pool_ != nullptr) {
+                    worker.tabu->Run(kTabuMovesPerStep, allowed, worker.random, [&](const std::vector<int32_t>& clique) {
+                        Offer(clique, false, worker.offered);
+                    });
+                } else {
+                    worker.tabu->Run(kTabuMovesPerStep, allowed, worker.random);
+                }
+                if (worker.tabu->GetBest().size() <= worker.best_clique->Size()) {
+                    continue;
+                }
+                worker.candidate = MakeClique(worker.tabu->GetBest());
+            } else if (worker.trajectory != nullptr) {
+                const uint64_t iteration = worker.stats.iterations + step;
+                const bool is_restart = iteration >= worker.run_end &&
+                                        (reducer_ == nullptr || reducer_->ActiveCount() > 0);
+                if (is_restart) {
+                    Restart(*worker.candidate, worker, ranks);
+                    worker.run += 1;
+                    worker.run_end = iteration + GetRunLength(options, worker.run);
+                    worker.stats.restarts += 1;
+                } else {
+                    *worker.candidate = *worker.trajectory;
+                    Perturb(*worker.candidate, worker, ranks);
+                }
+                if (pool_ != nullptr) {
+                    Offer(worker.candidate->GetVertices(), reducer_ == nullptr, worker.offered);
+                }
+                if (is_restart || worker.candidate->Weight() >= worker.trajectory->Weight()) {
+                    *worker.trajectory = *worker.candidate;
+                }
+            } else {
+                *worker.candidate = *worker.best_clique;
+                Perturb(*worker.candidate, worker, ranks);
+                if (pool_ != nullptr) {
+                    Offer(worker.candidate->GetVertices(), reducer_ == nullptr, worker.offered);
+                }
+            }
+
+            if (worker.candidate->Weight() > worker.best_clique->Weight()) {
+                std::swap(worker.best_clique, worker.candidate);
+                worker.improvements.push_back({ SecondsSinceStart(), worker.stats.iterations + step + 1,
+                                                worker.best_clique->Weight() });
+
+                size_t size = worker.best_clique->Weight();
+                size_t global_size = best_size.load(std::memory_order_relaxed);
+                while (size > global_size &&
+                       !best_size.compare_exchange_weak(global_size, size, std::memory_order_relaxed)) {
+                    // global_size is reloaded by the failed exchange.
+                }
+            }
+        }
+
+#ifdef MAX_CLIQUE_PROFILE
+        const uint64_t allocations = Profiler::ThreadAllocations() - allocations_before;
+        if (is_steady) {
+            PROFILE_COUNT(kSteadyAllocations, allocations);
+        }
+#endif
+
+        worker.stats.iterations += step;
+        if (worker.tabu != nullptr) {
+            worker.stats.moves = worker.tabu->MovesCount();
+        }
+        worker.stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+public:
+    static MaxCliqueProblem FromFile(const std::string& file,
+                                     GraphRepresentation representation = GraphRepresentation::kAdjacencyList,
+                                     LoadStats* stats = nullptr,
+                                     bool use_cache = false,
+                                     WeightSource weights = WeightSource::kNone) {
+        PROFILE_PHASE(kLoad);
+        std::unique_ptr<Graph> graph = Graph::Load(file, representation, stats, use_cache);
+        if (weights != WeightSource::kNone) {
+            graph->SetWeights(ReadVertexWeights(file, graph->Size(), weights));
+        }
+        return MaxCliqueProblem(std::move(graph));
+    }
+
+    // Solving leaves |graph| as it is, so it can be shared, e.g. with a graph cache.
+    explicit MaxCliqueProblem(std::shared_ptr<Graph> graph):
+        graph_(std::move(graph)),
+        original_graph_(),
+        original_ids_(),
+        order_(VertexOrder::kOriginal),
+        best_clique_(),
+        workers_stats_(),
+        exact_stats_(),
+        reducer_(),
+        upper_bound_(0),
+        colors_(),
+        colors_count_(0),
+        solve_start_(std::chrono::steady_clock::now()),
+        trace_(),
+        pool_(),
+        checkpoint_interval_(0),
+        on_checkpoint_(),
+        checkpoint_(),
+        resume_() {
+        // empty on purpose
+    }
+
+    MaxCliqueProblem(const MaxCliqueProblem& that) = delete;
+    MaxCliqueProblem& operator=(const MaxCliqueProblem& that) = delete;
+    MaxCliqueProblem(MaxCliqueProblem&& that) = default;
+    MaxCliqueProblem& operator=(MaxCliqueProblem&& that) = default;
+
+    // FindClique and FindExactClique hand a checkpoint to |on_checkpoint| every |interval| seconds
+    // and once they are over. It is called from the thread driving the search, or from a helper
+    // thread of the exact search, never from a worker.
+    void EnableCheckpoints(double interval, std::function<void(const Checkpoint&)> on_checkpoint) {
+        checkpoint_interval_ = interval;
+        on_checkpoint_ = std::move(on_checkpoint);
+    }
+
+    // The next FindClique and FindExactClique continue from |checkpoint| instead of starting over.
+    void ResumeFrom(Checkpoint checkpoint) {
+        resume_ = std::make_unique<Checkpoint>(std::move(checkpoint));
+    }
+
+    // Graph as loaded, with the edge updates applied.
+    [[nodiscard]] inline const Graph& GetGraph() const {
+        return original_graph_ != nullptr ? *original_graph_ : *graph_;
+    }
+
+    // Vertices of the best clique by their labels in the file.
+    [[nodiscard]] std::vector<int32_t> GetBestClique() const {
+        std::vector<int32_t> vertices = best_clique_->GetVertices();
+        if (!original_ids_.empty()) {
+            for (auto& v: vertices) {
+                v = original_ids_[v];
+            }
+        }
+        return vertices;
+    }
+
+    // Checks the best clique against the graph as loaded, so a broken relabelling is caught too.
+    [[nodiscard]] bool IsCliqueValid() const {
+        PROFILE_PHASE(kVerification);
+        if (best_clique_ == nullptr) {
+            return false;
+        }
+        if (original_graph_ == nullptr) {
+            return best_clique_->Verify();
+        }
+
+        const auto vertices = GetBestClique();
+        Clique original(vertices.front(), original_graph_.get());
+        for (const auto& v: vertices) {
+            original.AddVertex(v);
+        }
+        return original.Size() == vertices.size() && original.Verify();
+    }
+
+    // Relabels the vertices into |order|, the incumbent is carried over.
+    void Renumber(VertexOrder order) {
+        if (order == order_) {
+            return;
+        }
+
+        reducer_.reset();
+
+        if (order == VertexOrder::kOriginal) {
+            const auto incumbent = best_clique_ != nullptr ? GetBestClique() : std::vector<int32_t>();
+            if (!colors_.empty()) {
+                std::vector<int32_t> colors(colors_.size(), 0);
+                for (size_t v = 0; v < original_ids_.size(); v++) {
+                    colors[original_ids_[v]] = colors_[v];
+                }
+                colors_ = std::move(colors);
+            }
+            graph_ = std::move(original_graph_);
+            original_ids_.clear();
+            order_ = order;
+            best_clique_ = incumbent.empty() ? nullptr : MakeClique(incumbent);
+            return;
+        }
+
+        std::vector<int32_t> permutation(graph_->Size(), 0);
+        if (order == VertexOrder::kDegeneracy) {
+            const auto decomposition = ComputeCoreDecomposition(*graph_);
+            permutation.assign(decomposition.order.rbegin(), decomposition.order.rend());
+        } else {
+            ColoringEngine coloring(graph_.get());
+            BitSet vertices(graph_->Size());
+            for (size_t v = 0; v < graph_->Size(); v++) {
+                vertices.Set(static_cast<int32_t>(v));
+                permutation[v] = static_cast<int32_t>(v);
+            }
+            coloring.Color(vertices);
+            std::stable_sort(permutation.begin(), permutation.end(), [&](int32_t lhs, int32_t rhs) {
+                return std::make_tuple(coloring.GetColor(lhs), -static_cast<int64_t>(graph_->GetDegree(lhs))) <
+                       std::make_tuple(coloring.GetColor(rhs), -static_cast<int64_t>(graph_->GetDegree(rhs)));
+            });
+        }
+
+        std::vector<int32_t> new_ids(graph_->Size(), 0);
+        for (size_t v = 0; v < permutation.size(); v++) {
+            new_ids[permutation[v]] = static_cast<int32_t>(v);
+        }
+
+        std::vector<int32_t> incumbent;
+        if (best_clique_ != nullptr) {
+            for (const auto& v: best_clique_->GetVertices()) {
+                incumbent.push_back(new_ids[v]);
+            }
+        }
+
+        std::unique_ptr<Graph> permuted = graph_->Permute(permutation);
+        std::vector<int32_t> original_ids(permutation.size(), 0);
+        for (size_t v = 0; v < permutation.size(); v++) {
+            original_ids[v] = original_ids_.empty() ? permutation[v] : original_ids_[permutation[v]];
+        }
+
+        if (original_graph_ == nullptr) {
+            original_graph_ = std::move(graph_);
+        }
+        if (!colors_.empty()) {
+            std::vector<int32_t> colors(colors_.size(), 0);
+            for (size_t v = 0; v < permutation.size(); v++) {
+                colors[v] = colors_[permutation[v]];
+            }
+            colors_ = std::move(colors);
+        }
+
+        graph_ = std::move(permuted);
+        original_ids_ = std::move(original_ids);
+        order_ = order;
+        best_clique_ = incumbent.empty() ? nullptr : MakeClique(incumbent);
+    }
+
+    [[nodiscard]] inline const std::vector<WorkerStats>& GetWorkersStats() const {
+        return workers_stats_;
+    }
+
+    [[nodiscard]] inline const ExactStats& GetExactStats() const {
+        return exact_stats_;
+    }
+
+    [[nodiscard]] inline std::vector<ReductionStats> GetReductionHistory() const {
+        return reducer_ != nullptr ? reducer_->GetHistory() : std::vector<ReductionStats>();
+    }
+
+    // Branch and bound seeded with the current incumbent, so FindClique is worth running first.
+    // Proves the incumbent optimal or replaces it with a larger clique.
+    void FindExactClique(const ExactOptions& options = ExactOptions()) {
+        PROFILE_PHASE(kExact);
+        std::vector<int32_t> incumbent;
+        if (best_clique_ != nullptr) {
+            incumbent = best_clique_->GetVertices();
+        }
+
+        const BitSet* allowed = nullptr;
+        if (reducer_ != nullptr) {
+            reducer_->Reduce(GetSizeFloor());
+            allowed = &reducer_->GetActive();
+        }
+
+        // A whole-graph matrix is what CSR is there to avoid.
+        if (graph_->GetRepresentation() == GraphRepresentation::kCsr) {
+            if (graph_->HasWeights()) {
+                throw std::runtime_error("The exact search on CSR does not support weights");
+            }
+            FindExactCliqueLocally(incumbent, options, allowed);
+            return;
+        }
+
+        ExactOptions exact_options = options;
+        const ExactFrontier* resume = nullptr;
+        uint64_t resumed_nodes = 0;
+        if (resume_ != nullptr && resume_->has_frontier) {
+            resume = &resume_->frontier;
+            resumed_nodes = resume->nodes;
+        }
+        if (on_checkpoint_) {
+            exact_options.checkpoint_interval = checkpoint_interval_;
+            exact_options.on_checkpoint = [this, resumed_nodes](const ExactFrontier& frontier) {
+                Checkpoint checkpoint = checkpoint_;
+                checkpoint.has_frontier = true;
+                checkpoint.frontier = frontier;
+                checkpoint.frontier.nodes += resumed_nodes;
+                on_checkpoint_(checkpoint);
+            };
+        }
+
+        BranchAndBound branch_and_bound(*graph_);
+        const double offset = SecondsSinceStart();
+        std::vector<int32_t> offered;
+        const auto& clique = pool_ == nullptr ?
+                branch_and_bound.Solve(incumbent, exact_options, allowed, 0, {}, resume) :
+                branch_and_bound.Solve(incumbent, exact_options, allowed, pool_->GetFloor(),
+                                       [&](const std::vector<int32_t>& found) {
+                                           return Offer(found, false, offered);
+                                       }, resume);
+        exact_stats_ = branch_and_bound.GetStats();
+        resume_.reset();
+
+        // A search stopped by a limit has handed over its frontier already.
+        if (on_checkpoint_ && exact_stats_.is_optimal) {
+            Checkpoint checkpoint = checkpoint_;
+            checkpoint.has_frontier = true;
+            checkpoint.frontier.best = clique;
+            checkpoint.frontier.nodes = exact_stats_.nodes + resumed_nodes;
+            on_checkpoint_(checkpoint);
+        }
+
+        for (auto point: branch_and_bound.GetTrace()) {
+            point.seconds += offset;
+            AddTracePoint(point, nullptr);
+        }
+
+        if (graph_->GetWeight(clique) > graph_->GetWeight(incumbent)) {
+            best_clique_ = MakeClique(clique);
+        }
+    }
+
+    // Every clique lies within its first peeled vertex and the neighbours peeled after it, of which
+    // there are at most the core number, so each such neighbourhood is solved as a small dense problem.
+    // Neighbourhoods go from the densest core down and stop at the first core too small to beat the incumbent.
+    void FindExactCliqueLocally(std::vector<int32_t> best, const ExactOptions& options, const BitSet* allowed) {
+        const auto start = std::chrono::steady_clock::now();
+        const CoreDecomposition decomposition = ComputeCoreDecomposition(*graph_);
+        std::vector<uint32_t> positions(graph_->Size(), 0);
+        for (size_t i = 0; i < decomposition.order.size(); i++) {
+            positions[decomposition.order[i]] = static_cast<uint32_t>(i);
+        }
+
+        exact_stats_ = ExactStats();
+        exact_stats_.is_optimal = true;
+        exact_stats_.threads = std::max(1U, options.threads);
+
+        // With the pool, cliques of its size floor and below are of no use instead.
+        const auto floor = [&]() {
+            return pool_ != nullptr ? pool_->GetFloor() : best.size();
+        };
+
+        std::vector<int32_t> members;
+        std::vector<uint64_t> edges;
+        std::vector<int32_t> found;
+        std::vector<int32_t> offered;
+        for (size_t i = decomposition.order.size(); i > 0; i--) {
+            const int32_t v = decomposition.order[i - 1];
+            if (decomposition.cores[v] + 1 <= floor()) {
+                break;
+            }
+            if (allowed != nullptr && !allowed->Test(v)) {
+                continue;
+            }
+
+            members.clear();
+            graph_->ForEachNeighbour(v, [&](int32_t n) {
+                if (positions[n] > positions[v] && (allowed == nullptr || allowed->Test(n))) {
+                    members.push_back(n);
+                }
+            });
+            if (members.size() + 1 <= floor()) {
+                continue;
+            }
+            std::sort(members.begin(), members.end());
+
+            edges.clear();
+            for (size_t k = 0; k < members.size(); k++) {
+                graph_->ForEachNeighbourAmong(members[k], members, [&](int32_t, size_t position) {
+                    if (position > k) {
+                        edges.push_back(Graph::PackEdge(static_cast<uint32_t>(k), static_cast<uint32_t>(position)));
+                    }
+                });
+            }
+            const auto subgraph = Graph::FromEdges(members.size(), edges, GraphRepresentation::kAdjacencyMatrix);
+
+            ExactOptions local_options = options;
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (options.time_limit > 0) {
+                local_options.time_limit = options.time_limit - elapsed;
+            }
+            if (options.nodes_limit > 0) {
+                local_options.nodes_limit = options.nodes_limit - std::min(options.nodes_limit, exact_stats_.nodes);
+            }
+            if (local_options.time_limit < 0 || (options.nodes_limit > 0 && local_options.nodes_limit == 0)) {
+                exact_stats_.is_optimal = false;
+                break;
+            }
+
+            // Local cliques miss |v|, so they need one vertex less.
+            BranchAndBound branch_and_bound(*subgraph);
+            const size_t local_floor = std::max<size_t>(floor(), 1) - 1;
+            const auto clique = pool_ == nullptr ?
+                    branch_and_bound.Solve({}, local_options, nullptr, local_floor) :
+                    branch_and_bound.Solve({}, local_options, nullptr, local_floor,
+                                           [&](const std::vector<int32_t>& local) {
+                                               found.assign(1, v);
+                                               for (const auto& u: local) {
+                                                   found.push_back(members[u]);
+                                               }
+                                               return std::max<size_t>(Offer(found, false, offered), 1) - 1;
+                                           });
+            const ExactStats& local_stats = branch_and_bound.GetStats();
+            exact_stats_.nodes += local_stats.nodes;
+            exact_stats_.donated_tasks += local_stats.donated_tasks;
+            exact_stats_.stolen_tasks += local_stats.stolen_tasks;
+
+            if (clique.size() + 1 > best.size()) {
+                best = { v };
+                for (const auto& u: clique) {
+                    best.push_back(members[u]);
+                }
+                AddTracePoint({ "exact", SecondsSinceStart(), exact_stats_.nodes, best.size() }, nullptr);
+            }
+            if (!local_stats.is_optimal) {
+                exact_stats_.is_optimal = false;
+                break;
+            }
+        }
+
+        exact_stats_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!best.empty() && (best_clique_ == nullptr || best.size() > best_clique_->Size())) {
+            best_clique_ = MakeClique(best);
+        }
+    }
+
+    // Applies a batch of edge changes to the live problem. The incumbent is repaired by keeping
+    // the members adjacent to all the members kept before them, and the colouring by moving an
+    // endpoint of every monochromatic inserted edge to the lowest colour free among its neighbours,
+    // so FindClique with SearchOptions::warm_start can continue from both.
+    UpdateStats ApplyUpdates(const EdgeBatch& batch) {
+        const auto start = std::chrono::steady_clock::now();
+        UpdateStats stats;
+
+        for (auto* graph: { &graph_, &original_graph_ }) {
+            if (*graph != nullptr && graph->use_count() > 1) {
+                *graph = std::make_shared<Graph>(**graph);
+            }
+        }
+
+        std::vector<int32_t> internal_ids;
+        if (!original_ids_.empty()) {
+            internal_ids.assign(original_ids_.size(), 0);
+            for (size_t v = 0; v < original_ids_.size(); v++) {
+                internal_ids[original_ids_[v]] = static_cast<int32_t>(v);
+            }
+        }
+
+        const auto to_internal = [&](int32_t vertex) {
+            if (vertex < 0 || static_cast<size_t>(vertex) >= graph_->Size()) {
+                throw std::runtime_error("Edge update refers to vertex " + std::to_string(vertex + 1) +
+                                         " outside of the graph");
+            }
+            return internal_ids.empty() ? vertex : internal_ids[vertex];
+        };
+
+        for (const auto& [from, to]: batch.deletions) {
+            if (graph_->RemoveEdge(to_internal(from), to_internal(to))) {
+                stats.deleted += 1;
+                if (original_graph_ != nullptr) {
+                    original_graph_->RemoveEdge(from, to);
+                }
+            }
+        }
+
+        std::vector<uint8_t> is_used;
+        for (const auto& [from, to]: batch.insertions) {
+            const int32_t u = to_internal(from);
+            const int32_t v = to_internal(to);
+            if (!graph_->AddEdge(u, v)) {
+                continue;
+            }
+            stats.inserted += 1;
+            if (original_graph_ != nullptr) {
+                original_graph_->AddEdge(from, to);
+            }
+
+            if (!colors_.empty() && colors_[u] == colors_[v]) {
+                is_used.assign(colors_count_ + 1, 0);
+                graph_->ForEachNeighbour(v, [&](int32_t n) {
+                    is_used[colors_[n]] = 1;
+                });
+                colors_[v] = static_cast<int32_t>(std::find(is_used.begin(), is_used.end(), 0) - is_used.begin());
+                colors_count_ = std::max(colors_count_, static_cast<size_t>(colors_[v]) + 1);
+                stats.recolored += 1;
+            }
+        }
+
+        if (best_clique_ != nullptr) {
+            std::vector<int32_t> kept;
+            for (const auto& v: best_clique_->GetVertices()) {
+                if (std::all_of(kept.begin(), kept.end(), [&](int32_t k) { return graph_->HasEdge(v, k); })) {
+                    kept.push_back(v);
+                }
+            }
+            stats.dropped = best_clique_->Size() - kept.size();
+            best_clique_ = MakeClique(kept);
+            stats.clique_size = best_clique_->Size();
+        }
+
+        // Reductions, bounds and collected cliques were computed for the old edges.
+        reducer_.reset();
+        pool_.reset();
+        upper_bound_ = GetColoringBound();
+
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return stats;
+    }
+
+    // Greedy colouring-guided construction followed by perturbation search.
+    //
+    // Workers run in rounds of kStepsPerRound steps: every round starts from the global incumbent,
+    // improvements are published to an atomic size shared by all the workers, and the incumbent
+    // is merged after the round in worker order, so the result only depends on the seed and
+    // the amount of threads. The iteration budget, the target size and the upper bound end the
+    // search between rounds, within a round a worker only stops on its own clique. The time budget
+    // also stops the workers mid-round and is the only non-deterministic stop.
+    void FindClique(const SearchOptions& options = SearchOptions()) {
+        solve_start_ = std::chrono::steady_clock::now();
+        trace_.clear();
+        Renumber(options.order);
+
+        const uint32_t threads_count = std::max(1U, options.threads);
+        if (on_checkpoint_ || resume_ != nullptr) {
+            Checkpoint fingerprint;
+            fingerprint.vertices = graph_->Size();
+            fingerprint.edges = graph_->EdgesCount();
+            fingerprint.seed = options.seed;
+            fingerprint.threads = threads_count;
+            fingerprint.order = static_cast<uint32_t>(options.order);
+            fingerprint.improver = static_cast<uint32_t>(options.improver);
+            if (resume_ != nullptr &&
+                std::tie(resume_->vertices, resume_->edges, resume_->seed, resume_->threads, resume_->order, resume_->improver) !=
+                std::tie(fingerprint.vertices, fingerprint.edges, fingerprint.seed, fingerprint.threads, fingerprint.order,
+                         fingerprint.improver)) {
+                throw std::runtime_error("The checkpoint is of another graph, seed, threads, order or improver");
+            }
+            if (resume_ != nullptr && options.improver == Improver::kTabu) {
+                throw std::runtime_error("The tabu search state is not checkpointed, it cannot be resumed");
+            }
+            if (resume_ != nullptr && (resume_->random_states.size() != threads_count * Xoshiro256::kStateWords ||
+                                       resume_->worker_iterations.size() != threads_count)) {
+                throw std::runtime_error("Corrupted checkpoint");
+            }
+            checkpoint_ = std::move(fingerprint);
+        }
+
+        std::chrono::steady_clock::time_point deadline_time =
+                solve_start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(options.time_limit));
+        const std::chrono::steady_clock::time_point* deadline = options.time_limit > 0 ? &deadline_time : nullptr;
+
+        if (options.warm_start && best_clique_ != nullptr && !colors_.empty()) {
+            PROFILE_PHASE(kConstruction);
+            // The repaired incumbent may have room for the vertices of the inserted edges.
+            ColoringEngine coloring(graph_.get());
+            Complete(*best_clique_, coloring, nullptr, 1);
+            upper_bound_ = GetColoringBound();
+        } else {
+            PROFILE_PHASE(kConstruction);
+            ColoringEngine coloring(graph_.get());
+
+            BitSet vertices(graph_->Size());
+            for (size_t v = 0; v < graph_->Size(); v++) {
+                vertices.Set(static_cast<int32_t>(v));
+            }
+
+            coloring.Color(vertices);
+            int32_t vertex = coloring.PickVertex(0);
+
+            colors_.resize(graph_->Size());
+            for (size_t v = 0; v < colors_.size(); v++) {
+                colors_[v] = coloring.GetColor(static_cast<int32_t>(v));
+            }
+            colors_count_ = coloring.ColorsCount();
+            upper_bound_ = GetColoringBound();
+
+            std::unique_ptr<Clique> init_clique = std::make_unique<Clique>(vertex, graph_.get());
+            Complete(*init_clique, coloring, nullptr, 1);
+            best_clique_ = std::move(init_clique);
+        }
+        if (resume_ != nullptr && !resume_->incumbent.empty()) {
+            best_clique_ = MakeClique(resume_->incumbent);
+        }
+        AddTracePoint({ "construction", SecondsSinceStart(), 0, best_clique_->Weight() }, &options);
+
+        const bool is_weighted = graph_->HasWeights();
+        if (is_weighted && (options.top_k > 0 || options.improver == Improver::kTabu)) {
+            throw std::runtime_error("The tabu search and the clique pool do not support weights");
+        }
+
+        pool_.reset();
+        if (options.top_k > 0) {
+            pool_ = std::make_unique<CliquePool>(options.top_k, options.max_overlap);
+            std::vector<int32_t> offered;
+            Offer(best_clique_->GetVertices(), true, offered);
+            if (resume_ != nullptr) {
+                for (const auto& clique: resume_->pool_cliques) {
+                    pool_->Offer(clique);
+                }
+            }
+        }
+
+        reducer_.reset();
+        if (options.reduce && !is_weighted) {
+            reducer_ = std::make_unique<Reducer>(graph_.get());
+            reducer_->Reduce(GetSizeFloor());
+            upper_bound_ = std::min<size_t>(upper_bound_, reducer_->GetMaxCore() + 1);
+        }
+
+        std::vector<Worker> workers;
+        workers.reserve(threads_count);
+        for (uint32_t i = 0; i < threads_count; i++) {
+            workers.emplace_back(options.seed, i, graph_.get());
+            if (resume_ != nullptr) {
+                workers.back().random.SetState(resume_->random_states.data() + i * Xoshiro256::kStateWords);
+                workers.back().stats.iterations = resume_->worker_iterations.at(i);
+            }
+            workers.back().best_clique = std::make_unique<Clique>(*best_clique_);
+            workers.back().candidate = std::make_unique<Clique>(*best_clique_);
+            if (options.improver == Improver::kTabu) {
+                workers.back().tabu = std::make_unique<TabuSearch>(graph_.get());
+                workers.back().tabu->Reset(best_clique_->GetVertices());
+            } else if (options.restart != RestartPolicy::kNone) {
+                const bool is_resumed = resume_ != nullptr && i < resume_->trajectories.size() &&
+                                        !resume_->trajectories[i].empty();
+                workers.back().trajectory = is_resumed ? MakeClique(resume_->trajectories[i]) :
+                                                         std::make_unique<Clique>(*best_clique_);
+                StartRuns(workers.back(), options);
+            }
+        }
+
+        // Written by the workers during a round and read between rounds, once it equals the merged
+        // incumbent. A pool keeps collecting cliques as large as the bound.
+        std::atomic<size_t> best_size(best_clique_->Weight());
+        size_t stop_size = pool_ != nullptr ? std::numeric_limits<size_t>::max() : upper_bound_;
+        if (options.target_size > 0) {
+            stop_size = std::min(stop_size, options.target_size);
+        }
+
+        // With several workers every one runs in its own thread for the whole search, the rounds are
+        // started by bumping |round| and end once all the workers have checked in.
+        std::mutex round_mutex;
+        std::condition_variable round_started;
+        std::condition_variable round_finished;
+        uint64_t round = 0;
+        uint64_t round_steps = 0;
+        uint32_t finished_workers = 0;
+        bool is_stopped = false;
+
+        std::vector<std::thread> threads;
+        if (threads_count > 1) {
+            threads.reserve(threads_count);
+            for (auto& worker: workers) {
+                threads.emplace_back([&, this, current = &worker]() {
+                    uint64_t last_round = 0;
+                    while (true) {
+                        uint64_t steps = 0;
+                        {
+                            std::unique_lock<std::mutex> lock(round_mutex);
+                            round_started.wait(lock, [&]() { return is_stopped || round != last_round; });
+                            if (is_stopped) {
+                                return;
+                            }
+                            last_round = round;
+                            steps = round_steps;
+                        }
+
+                        RunWorker(*current, options, steps, best_size, stop_size, deadline);
+
+                        std::lock_guard<std::mutex> lock(round_mutex);
+                        if (++finished_workers == threads_count) {
+                            round_finished.notify_one();
+                        }
+                    }
+                });
+            }
+        }
+
+        uint64_t done = resume_ != nullptr ? resume_->steps : 0;
+        const bool is_resumed_done = resume_ != nullptr && resume_->is_heuristic_done;
+        auto last_checkpoint = std::chrono::steady_clock::now();
+        bool is_timed_out = false;
+        std::vector<Improvement> round_improvements;
+        for (; options.iterations == 0 || done < options.iterations; done += kStepsPerRound) {
+            if (is_resumed_done || GetSizeFloor() >= upper_bound_ ||
+                best_size.load(std::memory_order_relaxed) >= stop_size) {
+                break;
+            }
+            if (deadline != nullptr && std::chrono::steady_clock::now() >= *deadline) {
+                is_timed_out = true;
+                break;
+            }
+
+            const uint64_t steps = options.iterations == 0 ? kStepsPerRound :
+                                   std::min<uint64_t>(kStepsPerRound, options.iterations - done);
+
+            for (auto& worker: workers) {
+                *worker.best_clique = *best_clique_;
+            }
+
+            if (threads_count == 1) {
+                RunWorker(workers.front(), options, steps, best_size, stop_size, deadline);
+            } else {
+                std::unique_lock<std::mutex> lock(round_mutex);
+                finished_workers = 0;
+                round_steps = steps;
+                round++;
+                round_started.notify_all();
+                round_finished.wait(lock, [&]() { return finished_workers == threads_count; });
+            }
+
+            // The improvements of all the workers in the order they were found, each one traced if
+            // it beat every earlier one.
+            round_improvements.clear();
+            for (auto& worker: workers) {
+                round_improvements.insert(round_improvements.end(), worker.improvements.begin(), worker.improvements.end());
+                worker.improvements.clear();
+            }
+            std::stable_sort(round_improvements.begin(), round_improvements.end(),
+                             [](const Improvement& one, const Improvement& another) {
+                                 return one.seconds < another.seconds;
+                             });
+            size_t traced_size = best_clique_->Weight();
+            for (const auto& improvement: round_improvements) {
+                if (improvement.size > traced_size) {
+                    traced_size = improvement.size;
+                    AddTracePoint({ ToString(options.improver), improvement.seconds, improvement.iteration, improvement.size },
+                                  &options);
+                }
+            }
+
+            // The worker keeps the previous incumbent as the buffer to copy the next one into.
+            for (auto& worker: workers) {
+                if (worker.best_clique->Weight() > best_clique_->Weight()) {
+                    std::swap(best_clique_, worker.best_clique);
+                }
+            }
+
+            if (reducer_ != nullptr) {
+                reducer_->Reduce(GetSizeFloor());
+            }
+
+            // Workers wait for the next round meanwhile, and the writing is up to |on_checkpoint_|.
+            if (on_checkpoint_ && std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - last_checkpoint).count() >= checkpoint_interval_) {
+                SaveCheckpoint(workers, done + steps, false);
+                last_checkpoint = std::chrono::steady_clock::now();
+            }
+        }
+
+        if (!threads.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(round_mutex);
+                is_stopped = true;
+            }
+            round_started.notify_all();
+            for (auto& thread: threads) {
+                thread.join();
+            }
+        }
+
+        workers_stats_.clear();
+        for (const auto& worker: workers) {
+            workers_stats_.push_back(worker.stats);
+        }
+
+        // A resumed run goes on with the rounds a deadline has cut off.
+        if (on_checkpoint_) {
+            SaveCheckpoint(workers, done, !is_timed_out);
+        }
+        if (resume_ != nullptr && !resume_->has_frontier) {
+            resume_.reset();
+        }
+    }
+
+    [[nodiscard]] inline const std::vector<TracePoint>& GetTrace() const {
+        return trace_;
+    }
+
+    // Upper bound on the clique size (weight on a weighted graph) known after FindClique.
+    [[nodiscard]] inline size_t GetUpperBound() const {
+        return upper_bound_;
+    }
+
+    // Cliques collected with SearchOptions::top_k in the file labels, largest first.
+    [[nodiscard]] std::vector<std::vector<int32_t>> GetTopCliques() const {
+        return pool_ != nullptr ? pool_->GetCliques() : std::vector<std::vector<int32_t>>();
+    }
+
+    [[nodiscard]] inline const CliquePool* GetPool() const {
+        return pool_.get();
+    }
+};
+
+// Writes checkpoints to |filename| on a thread of its own, so the search never waits for the disk.
+// Only the latest checkpoint matters: one submitted while another is being written replaces the
+// queued one. It is written aside and renamed, a crash leaves the previous file intact.
+class CheckpointWriter {
+private:
+    std::string filename_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::unique_ptr<Checkpoint> queued_;
+    bool is_closed_;
+    size_t written_;
+    std::thread thread_;
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            changed_.wait(lock, [this]() { return is_closed_ || queued_ != nullptr; });
+            if (queued_ == nullptr) {
+                return;
+            }
+            const std::unique_ptr<Checkpoint> checkpoint = std::move(queued_);
+            lock.unlock();
+
+            const std::string bytes = checkpoint->Serialize();
+            const std::string temporary = filename_ + ".tmp";
+            bool is_written = false;
+            {
+                std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+                output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+                is_written = static_cast<bool>(output);
+            }
+            if (!is_written || std::rename(temporary.c_str(), filename_.c_str()) != 0) {
+                std::cerr << "Cannot write checkpoint " << filename_ << std::endl;
+                is_written = false;
+            }
+
+            lock.lock();
+            written_ += is_written ? 1 : 0;
+        }
+    }
+
+public:
+    explicit CheckpointWriter(std::string filename):
+        filename_(std::move(filename)),
+        mutex_(),
+        changed_(),
+        queued_(),
+        is_closed_(false),
+        written_(0),
+        thread_([this]() { Run(); }) {
+        // empty on purpose
+    }
+
+    CheckpointWriter(const CheckpointWriter& other) = delete;
+    CheckpointWriter(CheckpointWriter&& other) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter& other) = delete;
+    CheckpointWriter& operator=(CheckpointWriter&& other) = delete;
+
+    ~CheckpointWriter() {
+        Close();
+    }
+
+    void Submit(const Checkpoint& checkpoint) {
+        auto copy = std::make_unique<Checkpoint>(checkpoint);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queued_ = std::move(copy);
+        }
+        changed_.notify_one();
+    }
+
+    // Writes the queued checkpoint and returns how many were written.
+    size_t Close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_closed_ = true;
+        }
+        changed_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        return written_;
+    }
+
+    // Checkpoint stored in |filename|, or nullptr if there is none yet.
+    [[nodiscard]] static std::unique_ptr<Checkpoint> Load(const std::string& filename) {
+        std::ifstream input(filename, std::ios::binary);
+        if (!input) {
+            return nullptr;
+        }
+        std::ostringstream bytes;
+        bytes << input.rdbuf();
+        return std::make_unique<Checkpoint>(Checkpoint::Parse(bytes.str()));
+    }
+};
+
+// Wall-clock and process CPU time since construction. CPU time covers every thread,
+// so CPU over wall time shows how many cores a parallel solve kept busy.
+class Stopwatch {
+private:
+    std::chrono::steady_clock::time_point wall_start_;
+    double cpu_start_;
+
+    [[nodiscard]] static double CpuNow() {
+        timespec now = {};
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+        return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) * 1e-9;
+    }
+
+public:
+    Stopwatch():
+        wall_start_(std::chrono::steady_clock::now()),
+        cpu_start_(CpuNow()) {
+        // empty on purpose
+    }
+
+    [[nodiscard]] inline double WallSeconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start_).count();
+    }
+
+    [[nodiscard]] inline double CpuSeconds() const {
+        return CpuNow() - cpu_start_;
+    }
+};
+
+double RoundTo(double value, double precision = 1.0) {
+    return std::round(value / precision) * precision;
+}
+
+template<typename T>
+std::string ConvertToString(
+        const std::vector<T>& collection,
+        const std::string& delimiter = " ") {
+    std::ostringstream os;
+    for (size_t i = 0; i < collection.size(); i++) {
+        os << collection[i];
+        if (i != collection.size() -1 ) {
+            os << delimiter;
+        }
+    }
+    return os.str();
+}
+
+// Returns true and fills |value| if |argument| looks like --|name|=value.
+bool ParseFlag(const std::string& argument, const std::string& name, std::string& value) {
+    const std::string prefix = "--" + name + "=";
+    if (argument.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+
+    value = argument.substr(prefix.size());
+    return true;
+}
+
+std::vector<std::string> SplitString(const std::string& value, char delimiter) {
+    std::vector<std::string> result;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, delimiter)) {
+        if (!item.empty()) {
+            result.push_back(item);
+        }
+    }
+    return result;
+}
+
+// Solves every file exactly once per thread count and reports the time and the speedup
+// against the first thread count. Every run is seeded with the same heuristic clique.
+void RunScaling(const std::vector<std::string>& files,
+                const SearchOptions& search_options,
+                ExactOptions exact_options,
+                const std::vector<uint32_t>& threads,
+                bool use_cache) {
+    std::ofstream fout("scaling.csv");
+
+    std::cout << std::setfill(' ') << std::setw(20) << "Instance"
+              << std::setfill(' ') << std::setw(10) << "Clique";
+    for (const auto& threads_count: threads) {
+        std::cout << std::setfill(' ') << std::setw(12) << "T=" + std::to_string(threads_count) + ", sec";
+    }
+    std::cout << std::endl;
+    fout << "File; Clique; Threads; Time (sec); Nodes; Nodes/sec; Speedup; Status" << std::endl;
+
+    for (const auto& file: files) {
+        std::vector<ExactStats> runs;
+        size_t clique_size = 0;
+
+        for (const auto& threads_count: threads) {
+            MaxCliqueProblem problem = MaxCliqueProblem::FromFile("data/" + file,
+                                                                  GraphRepresentation::kAdjacencyMatrix,
+                                                                  nullptr,
+                                                                  use_cache);
+            problem.FindClique(search_options);
+
+            exact_options.threads = threads_count;
+            problem.FindExactClique(exact_options);
+
+            if (!problem.IsCliqueValid()) {
+                std::cout << "*** WARNING: incorrect clique ***\n";
+                fout << "*** WARNING: incorrect clique ***\n";
+                return;
+            }
+
+            clique_size = problem.GetBestClique().size();
+            runs.push_back(problem.GetExactStats());
+        }
+
+        std::cout << std::setfill(' ') << std::setw(20) << file
+                  << std::setfill(' ') << std::setw(10) << clique_size;
+        for (const auto& run: runs) {
+            const double speedup = run.seconds > 0 ? runs.front().seconds / run.seconds : 0.0;
+            std::cout << std::setfill(' ') << std::setw(12) << RoundTo(run.seconds, 0.001);
+            fout << file << "; " << clique_size << "; " << run.threads << "; " << run.seconds << "; "
+                 << run.nodes << "; " << run.NodesPerSecond() << "; " << speedup << "; "
+                 << (run.is_optimal ? "optimal" : "stopped") << std::endl;
+        }
+        std::cout << std::endl;
+
+        std::cout << std::setfill(' ') << std::setw(30) << "speedup:";
+        for (const auto& run: runs) {
+            const double speedup = run.seconds > 0 ? runs.front().seconds / run.seconds : 0.0;
+            std::cout << std::setfill(' ') << std::setw(11) << RoundTo(speedup, 0.01) << "x";
+        }
+        std::cout << std::endl;
+    }
+}
+
+// Everything printed for a single instance, so instances can be solved in any order
+// or in another process and reported in the input order.
+struct InstanceReport {
+    std::string console;
+    std::string csv;
+    std::string trace;
+    // Rows of profile.csv, empty unless built with MAX_CLIQUE_PROFILE.
+    std::string profile;
+    // Rows of cliques.csv, empty unless SearchOptions::top_k is set.
+    std::string cliques;
+};
+
+struct RunOptions {
+    std::vector<GraphRepresentation> representations;
+    SearchOptions search;
+    ExactOptions exact;
+    bool is_exact = false;
+    bool use_cache = true;
+    // Maximum weight clique instead of maximum clique.
+    WeightSource weights = WeightSource::kNone;
+    bool trace = false;
+    // Print incumbent improvements to stderr.
+    bool progress = false;
+    // Empty if checkpoints are off.
+    std::string checkpoint_dir;
+    double checkpoint_interval = 10.0;
+    bool resume = false;
+};
+
+// One checkpoint per instance and representation.
+std::string GetCheckpointFilename(const RunOptions& options, const std::string& name, GraphRepresentation representation) {
+    std::string flat_name = name;
+    std::replace(flat_name.begin(), flat_name.end(), '/', '_');
+    return options.checkpoint_dir + "/" + flat_name + "." + ToString(representation) + ".ckpt";
+}
+
+void PrintHeader(const RunOptions& options, std::ostream& console, std::ostream& csv) {
+    console << std::setfill(' ') << std::setw(20) << "Instance"
+            << std::setfill(' ') << std::setw(10) << "Clique";
+    csv << "File; Clique; ";
+    if (options.weights != WeightSource::kNone) {
+        console << std::setfill(' ') << std::setw(10) << "Weight";
+        csv << "Weight; ";
+    }
+    for (const auto& representation: options.representations) {
+        console << std::setfill(' ') << std::setw(20) << "Time " + ToString(representation) + ", sec";
+        csv << "Time " << ToString(representation) << " (sec); CPU " << ToString(representation) << " (sec); "
+            << "Memory " << ToString(representation) << " (bytes/edge); ";
+    }
+    if (options.representations.size() > 1) {
+        console << std::setfill(' ') << std::setw(10) << "Speedup";
+        csv << "Speedup; ";
+    }
+    console << std::setfill(' ') << std::setw(8) << "Backend"
+            << std::setfill(' ') << std::setw(8) << "B/edge"
+            << std::setfill(' ') << std::setw(8) << "Source"
+            << std::setfill(' ') << std::setw(12) << "Load, sec"
+            << std::setfill(' ') << std::setw(10) << "MB/s"
+            << std::setfill(' ') << std::setw(12) << "Edges/s";
+    csv << "Backend; Source; Load (sec); Parse (MB/s); Parse (edges/s); ";
+    if (options.is_exact) {
+        console << std::setfill(' ') << std::setw(12) << "Nodes"
+                << std::setfill(' ') << std::setw(12) << "Nodes/sec"
+                << std::setfill(' ') << std::setw(10) << "Status";
+        csv << "Nodes; Nodes/sec; Status; ";
+    }
+    console << std::endl;
+    csv << "Clique vertices" << std::endl;
+}
+
+// Solves the instance at |path| once per representation, |name| is the one reported.
+InstanceReport SolveInstance(const std::string& path, const std::string& name, const RunOptions& options) {
+    InstanceReport report;
+    std::ostringstream console;
+    std::ostringstream csv;
+    std::ostringstream trace;
+
+    std::vector<double> seconds;
+    std::vector<double> cpu_seconds;
+    std::vector<double> bytes_per_edge;
+    GraphRepresentation backend = GraphRepresentation::kAuto;
+    std::vector<int32_t> best_clique;
+    size_t best_weight = 0;
+    std::vector<WorkerStats> workers_stats;
+    ExactStats exact_stats;
+    LoadStats load_stats;
+    std::vector<ReductionStats> reductions;
+    std::vector<std::vector<int32_t>> top_cliques;
+    uint64_t offered = 0;
+    uint64_t duplicates = 0;
+    size_t checkpoints = 0;
+    bool is_resumed = false;
+
+#ifdef MAX_CLIQUE_PROFILE
+    Profiler::Reset();
+#endif
+
+    SearchOptions search_options = options.search;
+    if (options.progress) {
+        search_options.on_improvement = [&name](const TracePoint& point) {
+            std::cerr << name << ": " << point.phase << " " << point.size
+                      << " at " << RoundTo(point.seconds, 0.001) << "s, iteration " << point.iteration << std::endl;
+        };
+    }
+
+    for (const auto& representation: options.representations) {
+        MaxCliqueProblem problem = MaxCliqueProblem::FromFile(path, representation, &load_stats, options.use_cache,
+                                                              options.weights);
+        const Graph& graph = problem.GetGraph();
+        const size_t edges = std::max<size_t>(1, graph.EdgesCount());
+        bytes_per_edge.push_back(static_cast<double>(graph.MemoryBytes()) / edges);
+        backend = graph.GetRepresentation();
+
+        std::unique_ptr<CheckpointWriter> writer;
+        if (!options.checkpoint_dir.empty()) {
+            const std::string filename = GetCheckpointFilename(options, name, representation);
+            if (options.resume) {
+                auto checkpoint = CheckpointWriter::Load(filename);
+                if (checkpoint != nullptr) {
+                    problem.ResumeFrom(std::move(*checkpoint));
+                    is_resumed = true;
+                }
+            }
+            writer = std::make_unique<CheckpointWriter>(filename);
+            problem.EnableCheckpoints(options.checkpoint_interval, [&writer](const Checkpoint& checkpoint) {
+                writer->Submit(checkpoint);
+            });
+        }
+        const Stopwatch stopwatch;
+
+        // Same seed for every representation.
+        problem.FindClique(search_options);
+        if (options.is_exact) {
+            problem.FindExactClique(options.exact);
+        }
+
+        seconds.push_back(stopwatch.WallSeconds());
+        cpu_seconds.push_back(stopwatch.CpuSeconds());
+        if (writer != nullptr) {
+            checkpoints = writer->Close();
+        }
+
+        if (!problem.IsCliqueValid()) {
+            report.console = "*** WARNING: incorrect clique ***\n";
+            report.csv = report.console;
+            return report;
+        }
+
+        best_clique = problem.GetBestClique();
+        best_weight = graph.GetWeight(best_clique);
+        workers_stats = problem.GetWorkersStats();
+        exact_stats = problem.GetExactStats();
+        reductions = problem.GetReductionHistory();
+        top_cliques = problem.GetTopCliques();
+        if (problem.GetPool() != nullptr) {
+            offered = problem.GetPool()->OfferedCount();
+            duplicates = problem.GetPool()->DuplicatesCount();
+        }
+
+        if (options.trace) {
+            for (const auto& point: problem.GetTrace()) {
+                trace << name << "; " << ToString(representation) << "; " << point.phase << "; "
+                      << point.seconds << "; " << point.iteration << "; " << point.size << std::endl;
+            }
+        }
+    }
+
+    csv << name << "; "
+        << best_clique.size() << "; ";
+    console << std::setfill(' ') << std::setw(20) << name
+            << std::setfill(' ') << std::setw(10) << best_clique.size();
+    if (options.weights != WeightSource::kNone) {
+        csv << best_weight << "; ";
+        console << std::setfill(' ') << std::setw(10) << best_weight;
+    }
+    for (size_t i = 0; i < seconds.size(); i++) {
+        csv << seconds[i] << "; " << cpu_seconds[i] << "; " << bytes_per_edge[i] << "; ";
+        console << std::setfill(' ') << std::setw(20) << RoundTo(seconds[i], 0.001);
+    }
+    if (seconds.size() > 1) {
+        double speedup = seconds.back() > 0 ? seconds.front() / seconds.back() : 0.0;
+        csv << speedup << "; ";
+        console << std::setfill(' ') << std::setw(9) << RoundTo(speedup, 0.01) << "x";
+    }
+    const std::string source = load_stats.from_cache ? "cache" : "text";
+    console << std::setfill(' ') << std::setw(8) << ToString(backend)
+            << std::setfill(' ') << std::setw(8) << RoundTo(bytes_per_edge.back(), 0.1);
+    csv << ToString(backend) << "; " << source << "; " << load_stats.Seconds() << "; " << load_stats.MegabytesPerSecond() << "; "
+        << load_stats.EdgesPerSecond() << "; ";
+    console << std::setfill(' ') << std::setw(8) << source
+            << std::setfill(' ') << std::setw(12) << RoundTo(load_stats.Seconds(), 0.001)
+            << std::setfill(' ') << std::setw(10) << RoundTo(load_stats.MegabytesPerSecond(), 0.1)
+            << std::setfill(' ') << std::setw(12) << static_cast<uint64_t>(load_stats.EdgesPerSecond());
+    if (options.is_exact) {
+        const std::string status = exact_stats.is_optimal ? "optimal" : "stopped";
+        csv << exact_stats.nodes << "; " << exact_stats.NodesPerSecond() << "; " << status << "; ";
+        console << std::setfill(' ') << std::setw(12) << exact_stats.nodes
+                << std::setfill(' ') << std::setw(12) << static_cast<uint64_t>(exact_stats.NodesPerSecond())
+                << std::setfill(' ') << std::setw(10) << status;
+    }
+    csv << ConvertToString(best_clique, ", ") << std::endl;
+    console << std::endl;
+
+    if (!reductions.empty()) {
+        console << std::setfill(' ') << std::setw(20) << "reductions:";
+        for (const auto& reduction: reductions) {
+            console << " [>" << reduction.clique_size << " " << reduction.stage
+                    << " -" << reduction.vertices_removed << "v -" << reduction.edges_removed << "e]";
+        }
+        console << std::endl;
+    }
+
+    if (workers_stats.size() > 1) {
+        console << std::setfill(' ') << std::setw(20) << "iterations/sec:";
+        for (const auto& stats: workers_stats) {
+            console << " " << RoundTo(stats.IterationsPerSecond(), 1.0);
+        }
+        console << std::endl;
+    }
+
+    if (options.search.top_k > 0) {
+        std::ostringstream cliques;
+        for (size_t i = 0; i < top_cliques.size(); i++) {
+            cliques << name << "; " << i + 1 << "; " << top_cliques[i].size() << "; "
+                    << ConvertToString(top_cliques[i], ", ") << std::endl;
+        }
+        report.cliques = cliques.str();
+
+        console << std::setfill(' ') << std::setw(20) << "top cliques:" << " " << top_cliques.size();
+        if (!top_cliques.empty()) {
+            console << " of sizes " << top_cliques.front().size() << ".." << top_cliques.back().size();
+        }
+        console << ", " << offered << " offered, " << duplicates << " duplicates" << std::endl;
+    }
+
+    if (!options.checkpoint_dir.empty()) {
+        console << std::setfill(' ') << std::setw(20) << "checkpoints:" << " " << checkpoints << " written"
+                << (is_resumed ? ", resumed" : "") << std::endl;
+    }
+
+    if (options.search.improver == Improver::kTabu) {
+        console << std::setfill(' ') << std::setw(20) << "moves/sec:";
+        for (const auto& stats: workers_stats) {
+            console << " " << static_cast<uint64_t>(stats.MovesPerSecond());
+        }
+        console << std::endl;
+    }
+
+#ifdef MAX_CLIQUE_PROFILE
+    // Summed over the representations.
+    const ProfileSnapshot profile = Profiler::Snapshot();
+    std::ostringstream profile_csv;
+    console << std::setfill(' ') << std::setw(20) << "profile, ms:";
+    for (size_t i = 0; i < static_cast<size_t>(ProfilePhase::kCount); i++) {
+        const auto phase = ToString(static_cast<ProfilePhase>(i));
+        const double milliseconds = profile.phase_nanoseconds[i] * 1e-6;
+        console << " " << phase << "=" << RoundTo(milliseconds, 0.01);
+        profile_csv << name << "; phase; " << phase << "; " << milliseconds << std::endl;
+    }
+    console << std::endl << std::setfill(' ') << std::setw(20) << "counters:";
+    for (size_t i = 0; i < static_cast<size_t>(ProfileCounter::kCount); i++) {
+        const auto counter = ToString(static_cast<ProfileCounter>(i));
+        console << " " << counter << "=" << profile.counters[i];
+        profile_csv << name << "; counter; " << counter << "; " << profile.counters[i] << std::endl;
+    }
+    console << std::endl;
+    report.profile = profile_csv.str();
+#endif
+
+    report.console = console.str();
+    report.csv = csv.str();
+    report.trace = trace.str();
+    return report;
+}
+
+// Instances of a glob pattern, or of a manifest file listing one path per line ('#' starts a comment).
+// A DIMACS graph file is a batch of itself.
+std::vector<std::string> ListInstances(const std::string& source) {
+    std::vector<std::string> paths;
+
+    if (source.find_first_of("*?[") != std::string::npos) {
+        glob_t matches = {};
+        if (glob(source.c_str(), 0, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; i++) {
+                paths.emplace_back(matches.gl_pathv[i]);
+            }
+        }
+        globfree(&matches);
+        return paths;
+    }
+
+    std::ifstream manifest(source);
+    if (!manifest) {
+        throw std::runtime_error("Cannot open manifest " + source);
+    }
+
+    std::string line;
+    while (std::getline(manifest, line)) {
+        line = line.substr(0, line.find('#'));
+        line.erase(0, line.find_first_not_of(" \t\r"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        // A DIMACS problem line: the source is a graph, not a manifest.
+        if (line.size() > 1 && line[0] == 'p' && (line[1] == ' ' || line[1] == '\t')) {
+            return { source };
+        }
+        if (!line.empty()) {
+            paths.push_back(line);
+        }
+    }
+    return paths;
+}
+
+void WriteString(FILE* file, const std::string& value) {
+    const uint64_t size = value.size();
+    std::fwrite(&size, sizeof(size), 1, file);
+    std::fwrite(value.data(), 1, value.size(), file);
+}
+
+bool ReadString(FILE* file, std::string& value) {
+    uint64_t size = 0;
+    if (std::fread(&size, sizeof(size), 1, file) != 1) {
+        return false;
+    }
+    value.resize(size);
+    return std::fread(&value[0], 1, size, file) == size;
+}
+
+// Solves the instances in |jobs| forked processes, largest file first so the long solves do not
+// end up at the tail. Every child writes its report to an anonymous temporary file, and the reports
+// are printed in the input order as soon as all the preceding ones are done.
+void RunBatch(const std::vector<std::string>& paths,
+              const RunOptions& options,
+              uint32_t jobs,
+              std::ostream& console,
+              std::ostream& csv,
+              std::ostream& trace,
+              std::ostream& profile,
+              std::ostream& cliques) {
+    std::vector<std::pair<off_t, size_t>> order;
+    for (size_t i = 0; i < paths.size(); i++) {
+        struct stat info = {};
+        order.emplace_back(stat(paths[i].c_str(), &info) == 0 ? info.st_size : 0, i);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first > rhs.first;
+    });
+
+    std::vector<InstanceReport> reports(paths.size());
+    std::vector<bool> is_done(paths.size(), false);
+    std::unordered_map<pid_t, std::pair<size_t, FILE*>> running;
+    size_t next_job = 0;
+    size_t next_report = 0;
+
+    while (next_job < order.size() || !running.empty()) {
+        while (next_job < order.size() && running.size() < std::max(1U, jobs)) {
+            const size_t index = order[next_job++].second;
+            FILE* output = std::tmpfile();
+            if (output == nullptr) {
+                throw std::runtime_error("Cannot create a temporary file");
+            }
+
+            std::cout.flush();
+            const pid_t pid = fork();
+            if (pid < 0) {
+                throw std::runtime_error("Cannot fork a batch worker");
+            }
+
+            if (pid == 0) {
+                int status = 0;
+                try {
+                    const InstanceReport report = SolveInstance(paths[index], paths[index], options);
+                    WriteString(output, report.console);
+                    WriteString(output, report.csv);
+                    WriteString(output, report.trace);
+                    WriteString(output, report.profile);
+                    WriteString(output, report.cliques);
+                } catch (const std::exception& error) {
+                    std::cerr << paths[index] << ": " << error.what() << std::endl;
+                    status = 1;
+                }
+                std::fflush(output);
+                _exit(status);
+            }
+
+            running[pid] = { index, output };
+        }
+
+        int status = 0;
+        const pid_t pid = wait(&status);
+        if (pid < 0) {
+            throw std::runtime_error("Lost batch workers");
+        }
+
+        const auto it = running.find(pid);
+        if (it == running.end()) {
+            continue;
+        }
+
+        const size_t index = it->second.first;
+        FILE* output = it->second.second;
+        running.erase(it);
+
+        auto& report = reports[index];
+        std::rewind(output);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+            !ReadString(output, report.console) || !ReadString(output, report.csv) || !ReadString(output, report.trace) ||
+            !ReadString(output, report.profile) || !ReadString(output, report.cliques)) {
+            report.console = "*** WARNING: " + paths[index] + " failed ***\n";
+            report.csv = report.console;
+            report.trace.clear();
+            report.profile.clear();
+            report.cliques.clear();
+        }
+        std::fclose(output);
+        is_done[index] = true;
+
+        for (; next_report < paths.size() && is_done[next_report]; next_report++) {
+            console << reports[next_report].console << std::flush;
+            csv << reports[next_report].csv;
+            trace << reports[next_report].trace;
+            profile << reports[next_report].profile;
+            cliques << reports[next_report].cliques;
+            reports[next_report] = InstanceReport();
+        }
+    }
+}
+
+// Nearest-rank percentile of sorted |values|, |rank| is in [0, 1].
+double Percentile(const std::vector<double>& values, double rank) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    const auto index = static_cast<size_t>(std::ceil(rank * static_cast<double>(values.size())));
+    return values[std::min(values.size(), std::max<size_t>(index, 1)) - 1];
+}
+
+std::string EscapeJson(const std::string& value) {
+    std::string result;
+    for (const auto& c: value) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+
+// Times every supported kernel set on the rows of the 200-1500 vertex instances against a random
+// half-full bitset, checks that all of them compute the same, and writes the results to kernels.csv.
+void RunKernelBenchmark(const std::vector<std::pair<std::string, std::string>>& instances, bool use_cache) {
+    // Row operations per measurement.
+    constexpr size_t kOperations = 4000000;
+    const std::vector<SimdLevel> levels = { SimdLevel::kScalar, SimdLevel::kAvx2, SimdLevel::kAvx512 };
+    const std::vector<std::string> kernel_names = { "and", "and_not", "and_count", "count" };
+
+    std::ofstream csv("kernels.csv");
+    csv << "File; Vertices; Words; Kernel; Level; ns/row; Speedup" << std::endl;
+
+    std::cout << std::setfill(' ') << std::setw(20) << "Instance"
+              << std::setfill(' ') << std::setw(10) << "Vertices"
+              << std::setfill(' ') << std::setw(12) << "Kernel";
+    for (const auto& level: levels) {
+        std::cout << std::setfill(' ') << std::setw(16) << ToString(level) + ", ns/row";
+    }
+    std::cout << std::endl;
+
+    for (const auto& [path, name]: instances) {
+        const auto graph = Graph::Load(path, GraphRepresentation::kAdjacencyMatrix, nullptr, use_cache);
+        const size_t vertices = graph->Size();
+        if (vertices < 200 || vertices > 1500) {
+            continue;
+        }
+
+        const size_t words = WordsForBits(vertices);
+        const size_t passes = std::max<size_t>(1, kOperations / vertices);
+
+        std::mt19937 random(1);
+        BitSet candidates(vertices);
+        for (int32_t v = 0; v < static_cast<int32_t>(vertices); v++) {
+            if (random() % 2 == 0) {
+                candidates.Set(v);
+            }
+        }
+
+        for (size_t kernel = 0; kernel < kernel_names.size(); kernel++) {
+            std::vector<double> nanoseconds(levels.size(), 0.0);
+            std::vector<uint64_t> checksums(levels.size(), 0);
+
+            for (size_t l = 0; l < levels.size(); l++) {
+                if (!IsSimdLevelSupported(levels[l])) {
+                    continue;
+                }
+
+                const BitKernels& kernels = GetBitKernels(levels[l]);
+                BitSet scratch = candidates;
+                uint64_t checksum = 0;
+
+                const auto start = std::chrono::steady_clock::now();
+                for (size_t pass = 0; pass < passes; pass++) {
+                    for (int32_t v = 0; v < static_cast<int32_t>(vertices); v++) {
+                        const uint64_t* row = graph->GetRow(v);
+                        if (kernel == 0) {
+                            kernels.and_words(scratch.Data(), row, words);
+                        } else if (kernel == 1) {
+                            kernels.and_not_words(scratch.Data(), row, words);
+                        } else if (kernel == 2) {
+                            checksum += kernels.and_count(candidates.Data(), row, words);
+                        } else {
+                            checksum += kernels.count(row, words);
+                        }
+                    }
+                    if (kernel < 2) {
+                        checksum += scratch.Count();
+                        scratch = candidates;
+                    }
+                }
+                const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+                nanoseconds[l] = elapsed.count() / static_cast<double>(passes * vertices);
+                checksums[l] = checksum;
+                if (checksums[l] != checksums.front()) {
+                    throw std::runtime_error(ToString(levels[l]) + " " + kernel_names[kernel] + " kernel mismatch");
+                }
+            }
+
+            std::cout << std::setfill(' ') << std::setw(20) << name
+                      << std::setfill(' ') << std::setw(10) << vertices
+                      << std::setfill(' ') << std::setw(12) << kernel_names[kernel];
+            for (size_t l = 0; l < levels.size(); l++) {
+                if (nanoseconds[l] == 0) {
+                    std::cout << std::setfill(' ') << std::setw(16) << "-";
+                    continue;
+                }
+
+                const double speedup = nanoseconds.front() / nanoseconds[l];
+                std::cout << std::setfill(' ') << std::setw(16) << RoundTo(nanoseconds[l], 0.01);
+                csv << name << "; " << vertices << "; " << words << "; " << kernel_names[kernel] << "; "
+                    << ToString(levels[l]) << "; " << nanoseconds[l] << "; " << speedup << std::endl;
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+// Solves every instance for the maximum weight clique, with the weights of |options| or the synthetic
+// ones, and compares it with the weight of the maximum clique found the unweighted way. Both exact
+// searches stop after the exact time limit, 10 seconds if it is not set. Results go to weighted.csv.
+void RunWeightedBenchmark(const std::vector<std::pair<std::string, std::string>>& instances, const RunOptions& options) {
+    const WeightSource source = options.weights != WeightSource::kNone ? options.weights : WeightSource::kSynthetic;
+    ExactOptions exact = options.exact;
+    if (exact.time_limit <= 0) {
+        exact.time_limit = 10;
+    }
+
+    std::ofstream csv("weighted.csv");
+    csv << "File; Weights; Vertices; Max clique size; Max clique weight; Heuristic weight; Heuristic (sec); "
+        << "Exact weight; Exact size; Nodes; Exact (sec); Status" << std::endl;
+
+    std::cout << std::setfill(' ') << std::setw(20) << "Instance"
+              << std::setfill(' ') << std::setw(10) << "Vertices"
+              << std::setfill(' ') << std::setw(14) << "Unweighted"
+              << std::setfill(' ') << std::setw(12) << "Heuristic"
+              << std::setfill(' ') << std::setw(10) << "Sec"
+              << std::setfill(' ') << std::setw(10) << "Exact"
+              << std::setfill(' ') << std::setw(6) << "Size"
+              << std::setfill(' ') << std::setw(12) << "Nodes"
+              << std::setfill(' ') << std::setw(10) << "Sec"
+              << std::setfill(' ') << std::setw(10) << "Status" << std::endl;
+
+    for (const auto& [path, name]: instances) {
+        MaxCliqueProblem unweighted = MaxCliqueProblem::FromFile(
+                path, GraphRepresentation::kAdjacencyMatrix, nullptr, options.use_cache);
+        unweighted.FindClique(options.search);
+        unweighted.FindExactClique(exact);
+        const auto max_clique = unweighted.GetBestClique();
+
+        MaxCliqueProblem problem = MaxCliqueProblem::FromFile(
+                path, GraphRepresentation::kAdjacencyMatrix, nullptr, options.use_cache, source);
+        const Graph& graph = problem.GetGraph();
+        const Stopwatch stopwatch;
+        problem.FindClique(options.search);
+        const double heuristic_seconds = stopwatch.WallSeconds();
+        const size_t heuristic_weight = graph.GetWeight(problem.GetBestClique());
+        problem.FindExactClique(exact);
+
+        if (!problem.IsCliqueValid()) {
+            std::cout << std::setfill(' ') << std::setw(20) << name << " *** WARNING: incorrect clique ***" << std::endl;
+            continue;
+        }
+
+        const auto clique = problem.GetBestClique();
+        const ExactStats& stats = problem.GetExactStats();
+        const std::string status = stats.is_optimal ? "optimal" : "stopped";
+        csv << name << "; " << ToString(source) << "; " << graph.Size() << "; " << max_clique.size() << "; "
+            << graph.GetWeight(max_clique) << "; " << heuristic_weight << "; " << heuristic_seconds << "; "
+            << graph.GetWeight(clique) << "; " << clique.size() << "; " << stats.nodes << "; " << stats.seconds << "; "
+            << status << std::endl;
+        std::cout << std::setfill(' ') << std::setw(20) << name
+                  << std::setfill(' ') << std::setw(10) << graph.Size()
+                  << std::setfill(' ') << std::setw(14) << graph.GetWeight(max_clique)
+                  << std::setfill(' ') << std::setw(12) << heuristic_weight
+                  << std::setfill(' ') << std::setw(10) << RoundTo(heuristic_seconds, 0.001)
+                  << std::setfill(' ') << std::setw(10) << graph.GetWeight(clique)
+                  << std::setfill(' ') << std::setw(6) << clique.size()
+                  << std::setfill(' ') << std::setw(12) << stats.nodes
+                  << std::setfill(' ') << std::setw(10) << RoundTo(stats.seconds, 0.001)
+                  << std::setfill(' ') << std::setw(10) << status << std::endl;
+    }
+}
+
+// Runs the heuristic with every restart policy on every instance, |repeats| times with the seeds
+// seed, seed + 1, ... and the same time budget, one second unless --time-budget is given, so the
+// policies are compared by the cliques they reach per CPU second. Every run goes to restarts.csv.
+void RunRestartBenchmark(const std::vector<std::pair<std::string, std::string>>& instances,
+                         const RunOptions& options,
+                         uint32_t repeats) {
+    const std::vector<RestartPolicy> policies = { RestartPolicy::kNone, RestartPolicy::kLuby, RestartPolicy::kGeometric };
+    SearchOptions search_options = options.search;
+    search_options.improver = Improver::kPerturbation;
+    if (search_options.time_limit <= 0) {
+        search_options.time_limit = 1.0;
+    }
+    search_options.iterations = 0;
+
+    std::ofstream csv("restarts.csv");
+    csv << "File; Policy; Run; Seed; Clique; Found (sec); CPU (sec); Iterations; Restarts" << std::endl;
+
+    std::cout << std::setfill(' ') << std::setw(20) << "Instance"
+              << std::setfill(' ') << std::setw(11) << "Policy"
+              << std::setfill(' ') << std::setw(7) << "Best"
+              << std::setfill(' ') << std::setw(7) << "Mean"
+              << std::setfill(' ') << std::setw(7) << "Worst"
+              << std::setfill(' ') << std::setw(12) << "Found, sec"
+              << std::setfill(' ') << std::setw(12) << "Iter/CPU s"
+              << std::setfill(' ') << std::setw(10) << "Restarts" << std::endl;
+
+    for (const auto& [path, name]: instances) {
+        for (const auto& policy: policies) {
+            std::vector<size_t> sizes;
+            double found_seconds = 0;
+            double cpu_seconds = 0;
+            uint64_t iterations = 0;
+            uint64_t restarts = 0;
+
+            for (uint32_t run = 0; run < repeats; run++) {
+                search_options.seed = options.search.seed + run;
+                search_options.restart = policy;
+
+                MaxCliqueProblem problem = MaxCliqueProblem::FromFile(
+                        path, GraphRepresentation::kAdjacencyMatrix, nullptr, options.use_cache);
+                const Stopwatch stopwatch;
+                problem.FindClique(search_options);
+                const double cpu = stopwatch.CpuSeconds();
+
+                const size_t size = problem.IsCliqueValid() ? problem.GetBestClique().size() : 0;
+                const double found = problem.GetTrace().empty() ? 0.0 : problem.GetTrace().back().seconds;
+                uint64_t run_iterations = 0;
+                uint64_t run_restarts = 0;
+                for (const auto& stats: problem.GetWorkersStats()) {
+                    run_iterations += stats.iterations;
+                    run_restarts += stats.restarts;
+                }
+
+                sizes.push_back(size);
+                found_seconds += found;
+                cpu_seconds += cpu;
+                iterations += run_iterations;
+                restarts += run_restarts;
+                csv << name << "; " << ToString(policy) << "; " << run << "; " << search_options.seed << "; "
+                    << size << "; " << found << "; " << cpu << "; " << run_iterations << "; " << run_restarts << std::endl;
+            }
+
+            const double mean = std::accumulate(sizes.begin(), sizes.end(), 0.0) / sizes.size();
+            std::cout << std::setfill(' ') << std::setw(20) << name
+                      << std::setfill(' ') << std::setw(11) << ToString(policy)
+                      << std::setfill(' ') << std::setw(7) << *std::max_element(sizes.begin(), sizes.end())
+                      << std::setfill(' ') << std::setw(7) << RoundTo(mean, 0.01)
+                      << std::setfill(' ') << std::setw(7) << *std::min_element(sizes.begin(), sizes.end())
+                      << std::setfill(' ') << std::setw(12) << RoundTo(found_seconds / repeats, 0.001)
+                      << std::setfill(' ') << std::setw(12) << static_cast<uint64_t>(cpu_seconds > 0 ? iterations / cpu_seconds : 0)
+                      << std::setfill(' ') << std::setw(10) << restarts / repeats << std::endl;
+        }
+    }
+}
+
+// Solves every instance |repeats| times per representation with the seeds seed, seed + 1, ...
+// and reports the spread of the wall time and of the clique size. Runs are sequential so they
+// do not compete for cores; the load is not timed. Every run goes to benchmark.csv, the summaries
+// to benchmark.json.
+void RunBenchmark(const std::vector<std::pair<std::string, std::string>>& instances,
+                  const RunOptions& options,
+                  uint32_t repeats) {
+    std::ofstream csv("benchmark.csv");
+    std::ofstream json("benchmark.json");
+
+    csv << "File; Representation; Run; Seed; Wall (sec); CPU (sec); Clique; Nodes; Status";
+#ifdef MAX_CLIQUE_PROFILE
+    csv << "; Allocations; Steady allocations";
+#endif
+    csv << std::endl;
+    json << "{" << std::endl
+         << "  \"repeats\": " << repeats << "," << std::endl
+         << "  \"threads\": " << options.search.threads << "," << std::endl
+         << "  \"mode\": \"" << (options.is_exact ? "exact" : "heuristic") << "\"," << std::endl
+         << "  \"improver\": \"" << ToString(options.search.improver) << "\"," << std::endl
+         << "  \"order\": \"" << ToString(options.search.order) << "\"," << std::endl
+         << "  \"instances\": [";
+
+    std::cout << std::setfill(' ') << std::setw(20) << "Instance"
+              << std::setfill(' ') << std::setw(8) << "Repr"
+              << std::setfill(' ') << std::setw(10) << "Min, sec"
+              << std::setfill(' ') << std::setw(12) << "Median, sec"
+              << std::setfill(' ') << std::setw(10) << "P95, sec"
+              << std::setfill(' ') << std::setw(10) << "CPU, sec"
+              << std::setfill(' ') << std::setw(7) << "Best"
+              << std::setfill(' ') << std::setw(7) << "Mean"
+              << std::setfill(' ') << std::setw(7) << "Worst" << std::endl;
+
+    bool is_first = true;
+    for (const auto& [path, name]: instances) {
+        for (const auto& representation: options.representations) {
+            std::vector<double> wall;
+            std::vector<double> cpu;
+            std::vector<size_t> sizes;
+
+            for (uint32_t run = 0; run < repeats; run++) {
+                SearchOptions search_options = options.search;
+                search_options.seed = options.search.seed + run;
+
+                MaxCliqueProblem problem = MaxCliqueProblem::FromFile(path, representation, nullptr, options.use_cache);
+#ifdef MAX_CLIQUE_PROFILE
+                Profiler::Reset();
+#endif
+                const Stopwatch stopwatch;
+                problem.FindClique(search_options);
+                if (options.is_exact) {
+                    problem.FindExactClique(options.exact);
+                }
+                wall.push_back(stopwatch.WallSeconds());
+                cpu.push_back(stopwatch.CpuSeconds());
+
+                const size_t size = problem.IsCliqueValid() ? problem.GetBestClique().size() : 0;
+                sizes.push_back(size);
+
+                const auto& exact_stats = problem.GetExactStats();
+                std::string status = size == 0 ? "invalid" : "heuristic";
+                if (size != 0 && options.is_exact) {
+                    status = exact_stats.is_optimal ? "optimal" : "stopped";
+                }
+                csv << name << "; " << ToString(representation) << "; " << run << "; " << search_options.seed << "; "
+                    << wall.back() << "; " << cpu.back() << "; " << size << "; "
+                    << (options.is_exact ? exact_stats.nodes : 0) << "; " << status;
+#ifdef MAX_CLIQUE_PROFILE
+                const ProfileSnapshot profile = Profiler::Snapshot();
+                csv << "; " << profile.counters[static_cast<size_t>(ProfileCounter::kAllocations)]
+                    << "; " << profile.counters[static_cast<size_t>(ProfileCounter::kSteadyAllocations)];
+#endif
+                csv << std::endl;
+            }
+
+            std::vector<double> sorted_wall = wall;
+            std::sort(sorted_wall.begin(), sorted_wall.end());
+            std::vector<double> sorted_cpu = cpu;
+            std::sort(sorted_cpu.begin(), sorted_cpu.end());
+            const size_t best = *std::max_element(sizes.begin(), sizes.end());
+            const size_t worst = *std::min_element(sizes.begin(), sizes.end());
+            double mean = 0;
+            for (const auto& size: sizes) {
+                mean += static_cast<double>(size) / static_cast<double>(sizes.size());
+            }
+
+            std::cout << std::setfill(' ') << std::setw(20) << name
+                      << std::setfill(' ') << std::setw(8) << ToString(representation)
+                      << std::setfill(' ') << std::setw(10) << RoundTo(sorted_wall.front(), 0.001)
+                      << std::setfill(' ') << std::setw(12) << RoundTo(Percentile(sorted_wall, 0.5), 0.001)
+                      << std::setfill(' ') << std::setw(10) << RoundTo(Percentile(sorted_wall, 0.95), 0.001)
+                      << std::setfill(' ') << std::setw(10) << RoundTo(Percentile(sorted_cpu, 0.5), 0.001)
+                      << std::setfill(' ') << std::setw(7) << best
+                      << std::setfill(' ') << std::setw(7) << RoundTo(mean, 0.01)
+                      << std::setfill(' ') << std::setw(7) << worst << std::endl;
+
+            json << (is_first ? "" : ",") << std::endl
+                 << "    {\"file\": \"" << EscapeJson(name) << "\", "
+                 << "\"representation\": \"" << ToString(representation) << "\", "
+                 << "\"seeds\": [" << options.search.seed << ", " << options.search.seed + repeats - 1 << "], "
+                 << "\"wall_sec\": {\"min\": " << sorted_wall.front()
+                 << ", \"median\": " << Percentile(sorted_wall, 0.5)
+                 << ", \"p95\": " << Percentile(sorted_wall, 0.95) << "}, "
+                 << "\"cpu_sec\": {\"min\": " << sorted_cpu.front()
+                 << ", \"median\": " << Percentile(sorted_cpu, 0.5)
+                 << ", \"p95\": " << Percentile(sorted_cpu, 0.95) << "}, "
+                 << "\"clique\": {\"best\": " << best << ", \"mean\": " << mean << ", \"worst\": " << worst << "}}";
+            is_first = false;
+        }
+    }
+
+    json << std::endl << "  ]" << std::endl << "}" << std::endl;
+}
+
+} // namespace
+
+#ifdef MAX_CLIQUE_PROFILE
+
+// Counts every heap allocation for the profile, the array forms forward to these.
+__attribute__((noinline)) void* operator new(size_t size) {
+    Profiler::Allocations().fetch_add(1, std::memory_order_relaxed);
+    Profiler::ThreadAllocations()++;
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new(size_t size, std::align_val_t alignment) {
+    Profiler::Allocations().fetch_add(1, std::memory_order_relaxed);
+    Profiler::ThreadAllocations()++;
+    const auto align = static_cast<size_t>(alignment);
+    if (void* pointer = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+#endif
+
+// Batches of edge updates, one per line as "+ u v" or "- u v" with 1-based vertices,
+// a line with "=" ends a batch and "#" starts a comment.
+std::vector<EdgeBatch> ReadUpdates(const std::string& filename) {
+    std::ifstream fin(filename);
+    if (!fin.is_open()) {
+        throw std::runtime_error("Can't open " + filename);
+    }
+
+    std::vector<EdgeBatch> batches(1);
+    std::string line;
+    while (std::getline(fin, line)) {
+        std::istringstream stream(line);
+        std::string kind;
+        if (!(stream >> kind) || kind[0] == '#') {
+            continue;
+        }
+        if (kind == "=") {
+            if (!batches.back().insertions.empty() || !batches.back().deletions.empty()) {
+                batches.emplace_back();
+            }
+            continue;
+        }
+
+        int32_t from = 0;
+        int32_t to = 0;
+        if ((kind != "+" && kind != "-") || !(stream >> from >> to) || from == to) {
+            throw std::runtime_error("Bad update line in " + filename + ": " + line);
+        }
+        auto& edges = kind == "+" ? batches.back().insertions : batches.back().deletions;
+        edges.emplace_back(from - 1, to - 1);
+    }
+
+    if (batches.back().insertions.empty() && batches.back().deletions.empty()) {
+        batches.pop_back();
+    }
+    return batches;
+}
+
+// Applies the update batches to a live problem and re-solves it warm after each of them.
+// A cold solve of the same graph runs first, the warm one is timed to reach its result.
+// Results go to updates.csv.
+void RunUpdates(const std::string& path, const std::string& updates_file, const RunOptions& options) {
+    const auto batches = ReadUpdates(updates_file);
+    const GraphRepresentation representation = options.representations.back();
+
+    const auto solve = [&options](MaxCliqueProblem& problem, const SearchOptions& search) {
+        const Stopwatch stopwatch;
+        problem.FindClique(search);
+        if (options.is_exact) {
+            problem.FindExactClique(options.exact);
+        }
+        if (!problem.IsCliqueValid()) {
+            throw std::runtime_error("Incorrect clique after an update");
+        }
+        return stopwatch.WallSeconds();
+    };
+
+    MaxCliqueProblem problem = MaxCliqueProblem::FromFile(path, representation, nullptr, options.use_cache);
+    const double initial_seconds = solve(problem, options.search);
+    std::cout << path << " (" << ToString(representation) << "): clique " << problem.GetBestClique().size()
+              << " in " << RoundTo(initial_seconds, 0.001) << "s, " << batches.size() << " batches" << std::endl;
+
+    std::ofstream csv("updates.csv");
+    csv << "Batch; Inserted; Deleted; Update (ms); Dropped; Recolored; Repaired; Resolve (sec); Clique; "
+        << "Cold (sec); Cold clique" << std::endl;
+    std::cout << std::setfill(' ') << std::setw(6) << "Batch"
+              << std::setfill(' ') << std::setw(10) << "Inserted"
+              << std::setfill(' ') << std::setw(10) << "Deleted"
+              << std::setfill(' ') << std::setw(12) << "Update, ms"
+              << std::setfill(' ') << std::setw(10) << "Dropped"
+              << std::setfill(' ') << std::setw(10) << "Repaired"
+              << std::setfill(' ') << std::setw(14) << "Resolve, sec"
+              << std::setfill(' ') << std::setw(8) << "Clique"
+              << std::setfill(' ') << std::setw(12) << "Cold, sec"
+              << std::setfill(' ') << std::setw(8) << "Cold" << std::endl;
+
+    SearchOptions warm_options = options.search;
+    warm_options.warm_start = true;
+    for (size_t i = 0; i < batches.size(); i++) {
+        const UpdateStats stats = problem.ApplyUpdates(batches[i]);
+        MaxCliqueProblem cold(std::make_unique<Graph>(problem.GetGraph()));
+        const double cold_seconds = solve(cold, options.search);
+        const size_t cold_size = cold.GetBestClique().size();
+
+        // The warm search stops once it matches the cold result, or proves the colouring bound.
+        const size_t cold_weight = cold.GetGraph().GetWeight(cold.GetBestClique());
+        warm_options.target_size = options.search.target_size > 0
+            ? std::min(options.search.target_size, cold_weight) : cold_weight;
+        const double resolve_seconds = solve(problem, warm_options);
+        const size_t clique_size = problem.GetBestClique().size();
+
+        csv << i + 1 << "; " << stats.inserted << "; " << stats.deleted << "; " << stats.seconds * 1000 << "; "
+            << stats.dropped << "; " << stats.recolored << "; " << stats.clique_size << "; " << resolve_seconds
+            << "; " << clique_size << "; " << cold_seconds << "; " << cold_size << std::endl;
+        std::cout << std::setfill(' ') << std::setw(6) << i + 1
+                  << std::setfill(' ') << std::setw(10) << stats.inserted
+                  << std::setfill(' ') << std::setw(10) << stats.deleted
+                  << std::setfill(' ') << std::setw(12) << RoundTo(stats.seconds * 1000, 0.001)
+                  << std::setfill(' ') << std::setw(10) << stats.dropped
+                  << std::setfill(' ') << std::setw(10) << stats.clique_size
+                  << std::setfill(' ') << std::setw(14) << RoundTo(resolve_seconds, 0.001)
+                  << std::setfill(' ') << std::setw(8) << clique_size
+                  << std::setfill(' ') << std::setw(12) << RoundTo(cold_seconds, 0.001)
+                  << std::setfill(' ') << std::setw(8) << cold_size << std::endl;
+    }
+}
+
+// Loaded graphs by path and representation, the least recently used go first once their
+// total memory is over the capacity. Graphs are handed out shared, so an evicted one lives on
+// until the requests using it finish. A file that changed on disk is loaded again.
+class GraphCache {
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<Graph> graph;
+        size_t bytes;
+        off_t source_size;
+        int64_t source_mtime;
+    };
+
+    size_t capacity_bytes_;
+    bool use_cache_;
+    size_t used_bytes_;
+    // The most recently used goes first.
+    std::list<Entry> entries_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    uint64_t hits_;
+    uint64_t misses_;
+    uint64_t evictions_;
+    mutable std::mutex mutex_;
+
+    void Erase(std::list<Entry>::iterator it) {
+        used_bytes_ -= it->bytes;
+        index_.erase(it->key);
+        entries_.erase(it);
+    }
+
+public:
+    // |use_cache| is about the binary cache files next to the graphs.
+    GraphCache(size_t capacity_bytes, bool use_cache):
+            capacity_bytes_(capacity_bytes),
+            use_cache_(use_cache),
+            used_bytes_(0),
+            entries_(),
+            index_(),
+            hits_(0),
+            misses_(0),
+            evictions_(0),
+            mutex_() {
+        // empty on purpose
+    }
+
+    GraphCache(const GraphCache& that) = delete;
+    GraphCache& operator=(const GraphCache& that) = delete;
+
+    // Concurrent misses on the same graph both load it, the last one stays cached.
+    std::shared_ptr<Graph> Get(const std::string& path,
+                               GraphRepresentation representation,
+                               bool& is_hit,
+                               double& load_seconds) {
+        struct stat source = {};
+        if (stat(path.c_str(), &source) != 0) {
+            throw std::runtime_error("Cannot stat " + path);
+        }
+        const std::string key = ToString(representation) + ":" + path;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto it = index_.find(key);
+            if (it != index_.end()) {
+                if (it->second->source_size == source.st_size &&
+                    it->second->source_mtime == ModificationTime(source)) {
+                    entries_.splice(entries_.begin(), entries_, it->second);
+                    hits_ += 1;
+                    is_hit = true;
+                    load_seconds = 0;
+                    return entries_.front().graph;
+                }
+                Erase(it->second);
+            }
+            misses_ += 1;
+        }
+
+        const Stopwatch stopwatch;
+        std::shared_ptr<Graph> graph = Graph::Load(path, representation, nullptr, use_cache_);
+        load_seconds = stopwatch.WallSeconds();
+        is_hit = false;
+
+        const size_t bytes = graph->MemoryBytes();
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = index_.find(key);
+        if (it != index_.end()) {
+            Erase(it->second);
+        }
+        if (bytes > capacity_bytes_) {
+            return graph;
+        }
+
+        entries_.push_front(Entry{ key, graph, bytes, source.st_size, ModificationTime(source) });
+        index_[key] = entries_.begin();
+        used_bytes_ += bytes;
+        while (used_bytes_ > capacity_bytes_) {
+            Erase(std::prev(entries_.end()));
+            evictions_ += 1;
+        }
+        return graph;
+    }
+
+    // As a JSON object.
+    [[nodiscard]] std::string GetStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ostringstream json;
+        json << "{\"graphs\": " << entries_.size() << ", \"bytes\": " << used_bytes_
+             << ", \"capacity_bytes\": " << capacity_bytes_ << ", \"hits\": " << hits_
+             << ", \"misses\": " << misses_ << ", \"evictions\": " << evictions_ << "}";
+        return json.str();
+    }
+
+    ~GraphCache() = default;
+};
+
+// Parses a flat JSON object into its keys and the raw text of their values, strings keep their quotes.
+std::unordered_map<std::string, std::string> ParseJsonObject(const std::string& text) {
+    std::unordered_map<std::string, std::string> result;
+    size_t i = 0;
+
+    const auto skip_blanks = [&]() {
+        while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i]))) {
+            i++;
+        }
+    };
+    const auto expect = [&](char c) {
+        skip_blanks();
+        if (i >= text.size() || text[i] != c) {
+            throw std::runtime_error(std::string("Expected '") + c + "' at offset " + std::to_string(i));
+        }
+        i++;
+    };
+    const auto read_string = [&]() {
+        const size_t start = i;
+        expect('"');
+        while (i < text.size() && text[i] != '"') {
+            i += text[i] == '\\' ? 2 : 1;
+        }
+        expect('"');
+        return text.substr(start, i - start);
+    };
+
+    expect('{');
+    skip_blanks();
+    if (i < text.size() && text[i] == '}') {
+        return result;
+    }
+    while (true) {
+        skip_blanks();
+        const std::string key = read_string();
+        expect(':');
+        skip_blanks();
+        if (i < text.size() && (text[i] == '{' || text[i] == '[')) {
+            throw std::runtime_error("Nested values are not supported");
+        }
+
+        std::string value;
+        if (i < text.size() && text[i] == '"') {
+            value = read_string();
+        } else {
+            const size_t start = i;
+            while (i < text.size() && text[i] != ',' && text[i] != '}' &&
+                   !std::isspace(static_cast<unsigned char>(text[i]))) {
+                i++;
+            }
+            value = text.substr(start, i - start);
+        }
+        result[key.substr(1, key.size() - 2)] = value;
+
+        skip_blanks();
+        if (i < text.size() && text[i] == ',') {
+            i++;
+            continue;
+        }
+        expect('}');
+        return result;
+    }
+}
+
+// Value of a JSON string token, only the \" and \\ escapes are decoded.
+std::string UnquoteJson(const std::string& token) {
+    if (token.size() < 2 || token.front() != '"' || token.back() != '"') {
+        return token;
+    }
+    std::string result;
+    for (size_t i = 1; i + 1 < token.size(); i++) {
+        if (token[i] == '\\' && i + 2 < token.size()) {
+            i++;
+        }
+        result += token[i];
+    }
+    return result;
+}
+
+// True if |token| is a JSON number or a JSON string, so it can be echoed as it is.
+bool IsJsonScalar(const std::string& token) {
+    if (token.size() >= 2 && token.front() == '"' && token.back() == '"') {
+        return std::none_of(token.begin(), token.end(), [](char c) { return static_cast<unsigned char>(c) < 0x20; });
+    }
+
+    size_t i = 0;
+    const auto digits = [&]() {
+        const size_t start = i;
+        while (i < token.size() && std::isdigit(static_cast<unsigned char>(token[i]))) {
+            i++;
+        }
+        return i > start;
+    };
+    if (i < token.size() && token[i] == '-') {
+        i++;
+    }
+    if (!digits()) {
+        return false;
+    }
+    if (i < token.size() && token[i] == '.') {
+        i++;
+        if (!digits()) {
+            return false;
+        }
+    }
+    if (i < token.size() && (token[i] == 'e' || token[i] == 'E')) {
+        i++;
+        if (i < token.size() && (token[i] == '+' || token[i] == '-')) {
+            i++;
+        }
+        if (!digits()) {
+            return false;
+        }
+    }
+    return i == token.size();
+}
+
+// The "id" of |request| to echo in the response, null if there is none.
+std::string GetRequestId(const std::unordered_map<std::string, std::string>& request) {
+    const auto it = request.find("id");
+    if (it == request.end() || it->second.empty()) {
+        return "null";
+    }
+    if (!IsJsonScalar(it->second)) {
+        throw std::runtime_error("The id must be a number or a string");
+    }
+    return it->second;
+}
+
+// Where the responses to the requests of one client go.
+class ServiceClient {
+private:
+    int descriptor_;
+    bool is_owned_;
+    std::mutex mutex_;
+
+public:
+    ServiceClient(int descriptor, bool is_owned):
+            descriptor_(descriptor),
+            is_owned_(is_owned),
+            mutex_() {
+        // empty on purpose
+    }
+
+    ServiceClient(const ServiceClient& that) = delete;
+    ServiceClient& operator=(const ServiceClient& that) = delete;
+
+    // Writes |line| and a line break, a client that went away is ignored.
+    void Send(const std::string& line) {
+        const std::string data = line + "\n";
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t sent = 0;
+        while (sent < data.size()) {
+            const ssize_t written = is_owned_ ?
+                    send(descriptor_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL) :
+                    write(descriptor_, data.data() + sent, data.size() - sent);
+            if (written <= 0) {
+                return;
+            }
+            sent += static_cast<size_t>(written);
+        }
+    }
+
+    // Wakes up a reader blocked on the client, the responses still go out.
+    void StopReading() {
+        if (is_owned_) {
+            shutdown(descriptor_, SHUT_RD);
+        }
+    }
+
+    ~ServiceClient() {
+        if (is_owned_) {
+            close(descriptor_);
+        }
+    }
+};
+
+// Readers wait for input at most this long before they look whether the service stopped.
+constexpr int kServicePollMilliseconds = 100;
+
+// Error response to a request that arrived after the service began to shut down.
+std::string RefuseRequest(const std::string& line) {
+    std::string id = "null";
+    try {
+        id = GetRequestId(ParseJsonObject(line));
+    } catch (const std::exception&) {
+        // the id stays null
+    }
+    return "{\"id\": " + id + ", \"status\": \"error\", \"error\": \"The service is shutting down\"}";
+}
+
+// Runs one request of the service and returns its JSON response.
+std::string HandleRequest(const std::string& line, const RunOptions& defaults, GraphCache& cache, bool& is_shutdown) {
+    std::string id = "null";
+    try {
+        const auto request = ParseJsonObject(line);
+        const auto field = [&request](const std::string& key) {
+            const auto it = request.find(key);
+            return it != request.end() ? it->second : std::string();
+        };
+        id = GetRequestId(request);
+
+        const std::string command = UnquoteJson(field("command"));
+        if (command == "shutdown") {
+            is_shutdown = true;
+            return "{\"id\": " + id + ", \"status\": \"ok\"}";
+        }
+        if (command == "stats") {
+            return "{\"id\": " + id + ", \"status\": \"ok\", \"cache\": " + cache.GetStats() + "}";
+        }
+        if (!command.empty() && command != "solve") {
+            throw std::runtime_error("Unknown command " + command);
+        }
+
+        const std::string path = UnquoteJson(field("graph"));
+        if (path.empty()) {
+            throw std::runtime_error("No graph in the request");
+        }
+
+        SearchOptions search = defaults.search;
+        ExactOptions exact = defaults.exact;
+        bool is_exact = defaults.is_exact;
+        GraphRepresentation representation = defaults.representations.back();
+
+        const std::string mode = UnquoteJson(field("mode"));
+        if (!mode.empty()) {
+            if (mode != "heuristic" && mode != "exact") {
+                throw std::runtime_error("Unknown mode " + mode);
+            }
+            is_exact = mode == "exact";
+        }
+        const std::string representation_name = UnquoteJson(field("representation"));
+        if (!representation_name.empty()) {
+            const std::vector<GraphRepresentation> known = {
+                    GraphRepresentation::kAdjacencyList, GraphRepresentation::kAdjacencyMatrix,
+                    GraphRepresentation::kCsr, GraphRepresentation::kAuto };
+            const auto it = std::find_if(known.begin(), known.end(), [&](GraphRepresentation r) {
+                return ToString(r) == representation_name;
+            });
+            if (it == known.end()) {
+                throw std::runtime_error("Unknown representation " + representation_name);
+            }
+            representation = *it;
+        }
+        // The budget covers the heuristic, and the exact search gets what the heuristic left.
+        double time_budget = 0;
+        if (!field("time_budget").empty()) {
+            time_budget = std::stod(field("time_budget"));
+            search.time_limit = time_budget;
+        }
+        if (!field("seed").empty()) {
+            search.seed = std::stoull(field("seed"));
+        }
+        if (!field("iterations").empty()) {
+            search.iterations = std::stoull(field("iterations"));
+        }
+        if (!field("threads").empty()) {
+            search.threads = static_cast<uint32_t>(std::stoul(field("threads")));
+            exact.threads = search.threads;
+        }
+        if (!field("top_k").empty()) {
+            search.top_k = std::stoul(field("top_k"));
+        }
+        if (search.iterations == 0 && search.time_limit <= 0) {
+            throw std::runtime_error("iterations 0 needs a time_budget");
+        }
+        search.on_improvement = nullptr;
+
+        bool is_hit = false;
+        double load_seconds = 0;
+        const auto graph = cache.Get(path, representation, is_hit, load_seconds);
+
+        // The problem shares the cached graph, only a relabelling order makes it a copy of its own.
+        const Stopwatch stopwatch;
+        MaxCliqueProblem problem(graph);
+        problem.FindClique(search);
+        if (is_exact) {
+            if (time_budget > 0) {
+                exact.time_limit = std::max(time_budget - stopwatch.WallSeconds(), 1e-3);
+            }
+            problem.FindExactClique(exact);
+        }
+        const double seconds = stopwatch.WallSeconds();
+        if (!problem.IsCliqueValid()) {
+            throw std::runtime_error("Incorrect clique");
+        }
+
+        std::ostringstream json;
+        json << "{\"id\": " << id << ", \"status\": \"ok\", \"graph\": \"" << EscapeJson(path) << "\""
+             << ", \"representation\": \"" << ToString(graph->GetRepresentation()) << "\""
+             << ", \"cache\": \"" << (is_hit ? "hit" : "miss") << "\", \"load_seconds\": " << load_seconds
+             << ", \"seconds\": " << seconds << ", \"size\": " << problem.GetBestClique().size()
+             << ", \"clique\": [" << ConvertToString(problem.GetBestClique(), ", ") << "]";
+        if (is_exact) {
+            json << ", \"optimal\": " << (problem.GetExactStats().is_optimal ? "true" : "false")
+                 << ", \"nodes\": " << problem.GetExactStats().nodes;
+        }
+        if (search.top_k > 0) {
+            json << ", \"top\": [";
+            const auto cliques = problem.GetTopCliques();
+            for (size_t i = 0; i < cliques.size(); i++) {
+                json << (i > 0 ? ", " : "") << "[" << ConvertToString(cliques[i], ", ") << "]";
+            }
+            json << "]";
+        }
+        json << "}";
+        return json.str();
+    } catch (const std::exception& error) {
+        return "{\"id\": " + id + ", \"status\": \"error\", \"error\": \"" + EscapeJson(error.what()) + "\"}";
+    }
+}
+
+// Serves JSON-line solve requests from stdin, or from the clients of the Unix socket at
+// |socket_path| if it is given, on |jobs| worker threads. Every request gets one response line,
+// in the order the requests finish, so clients match them by "id". Graphs stay loaded between
+// requests in a cache of |cache_bytes|. A "shutdown" request stops the service once the queued
+// requests are answered.
+void RunService(const std::string& socket_path, const RunOptions& options, uint32_t jobs, size_t cache_bytes) {
+    struct Job {
+        std::string line;
+        std::shared_ptr<ServiceClient> client;
+    };
+
+    GraphCache cache(cache_bytes, options.use_cache);
+    std::mutex queue_mutex;
+    std::condition_variable queue_changed;
+    std::deque<Job> queue;
+    bool is_closed = false;
+    int listener = -1;
+
+    // Set up before the workers start, so a failure has no threads to leave behind.
+    if (!socket_path.empty()) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Socket path is too long: " + socket_path);
+        }
+        std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(socket_path.c_str());
+        if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listener, SOMAXCONN) != 0) {
+            if (listener >= 0) {
+                close(listener);
+            }
+            throw std::runtime_error("Cannot listen on " + socket_path);
+        }
+        std::cerr << "Listening on " << socket_path << std::endl;
+    }
+
+    const auto close_queue = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            is_closed = true;
+        }
+        queue_changed.notify_all();
+        if (listener >= 0) {
+            // Wakes the accept loop up.
+            shutdown(listener, SHUT_RDWR);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < std::max(1U, jobs); i++) {
+        workers.emplace_back([&]() {
+            while (true) {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(queue_mutex);
+                    queue_changed.wait(lock, [&]() { return is_closed || !queue.empty(); });
+                    if (queue.empty()) {
+                        return;
+                    }
+                    job = std::move(queue.front());
+                    queue.pop_front();
+                }
+
+                bool is_shutdown = false;
+                job.client->Send(HandleRequest(job.line, options, cache, is_shutdown));
+                if (is_shutdown) {
+                    close_queue();
+                }
+            }
+        });
+    }
+
+    // Queues the lines of |descriptor| until it ends or the service stops, the lines already read
+    // by then are refused. Polls, so that a quiet stdin does not keep the service alive.
+    const auto read_requests = [&](int descriptor, const std::shared_ptr<ServiceClient>& client) {
+        std::string pending;
+        char buffer[4096];
+        while (true) {
+            pollfd input = {};
+            input.fd = descriptor;
+            input.events = POLLIN;
+            const int ready = poll(&input, 1, kServicePollMilliseconds);
+            if (ready < 0 && errno != EINTR) {
+                return;
+            }
+            if (ready > 0) {
+                const ssize_t size = read(descriptor, buffer, sizeof(buffer));
+                if (size <= 0) {
+                    return;
+                }
+                pending.append(buffer, static_cast<size_t>(size));
+            }
+
+            size_t line_end = 0;
+            while ((line_end = pending.find('\n')) != std::string::npos) {
+                std::string line = pending.substr(0, line_end);
+                pending.erase(0, line_end + 1);
+                if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                    continue;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(queue_mutex);
+                    if (!is_closed) {
+                        queue.push_back(Job{ std::move(line), client });
+                        queue_changed.notify_one();
+                        continue;
+                    }
+                }
+                client->Send(RefuseRequest(line));
+            }
+
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (is_closed) {
+                return;
+            }
+        }
+    };
+
+    if (socket_path.empty()) {
+        read_requests(STDIN_FILENO, std::make_shared<ServiceClient>(STDOUT_FILENO, false));
+        close_queue();
+    } else {
+        // A client expires once its reader ended and its requests are answered.
+        std::vector<std::pair<std::thread, std::weak_ptr<ServiceClient>>> readers;
+        while (true) {
+            const int descriptor = accept(listener, nullptr, nullptr);
+            if (descriptor < 0) {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                if (is_closed) {
+                    break;
+                }
+                continue;
+            }
+
+            readers.erase(std::remove_if(readers.begin(), readers.end(), [](auto& reader) {
+                if (!reader.second.expired()) {
+                    return false;
+                }
+                reader.first.join();
+                return true;
+            }), readers.end());
+            auto client = std::make_shared<ServiceClient>(descriptor, true);
+            readers.emplace_back(std::thread(read_requests, descriptor, client), client);
+        }
+        close(listener);
+        unlink(socket_path.c_str());
+
+        for (auto& reader: readers) {
+            if (const auto client = reader.second.lock()) {
+                client->StopReading();
+            }
+            reader.first.join();
+        }
+    }
+
+    for (auto& worker: workers) {
+        worker.join();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Every instance is solved once per representation, so the speedup of the matrix over the list is visible.
+    RunOptions run_options;
+    run_options.representations = { GraphRepresentation::kAdjacencyList, GraphRepresentation::kAdjacencyMatrix };
+
+    std::vector<uint32_t> scaling_threads;
+    std::string trace_file;
+    std::string batch_source;
+    std::string instance;
+    std::string updates_file;
+    bool is_service = false;
+    std::string socket_path;
+    size_t cache_megabytes = 1024;
+    uint32_t jobs = std::max(1U, std::thread::hardware_concurrency());
+    uint32_t repeats = 0;
+    bool is_kernel_benchmark = false;
+    bool is_weighted_benchmark = false;
+    bool is_restart_benchmark = false;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string argument(argv[i]);
+        std::string value;
+
+        if (argument == "--representation=list") {
+            run_options.representations = { GraphRepresentation::kAdjacencyList };
+        } else if (argument == "--representation=matrix") {
+            run_options.representations = { GraphRepresentation::kAdjacencyMatrix };
+        } else if (argument == "--representation=csr") {
+            run_options.representations = { GraphRepresentation::kCsr };
+        } else if (argument == "--representation=auto") {
+            run_options.representations = { GraphRepresentation::kAuto };
+        } else if (argument == "--representation=compare") {
+            // default
+        } else if (ParseFlag(argument, "threads", value)) {
+            run_options.search.threads = static_cast<uint32_t>(std::stoul(value));
+            run_options.exact.threads = run_options.search.threads;
+        } else if (ParseFlag(argument, "seed", value)) {
+            run_options.search.seed = std::stoull(value);
+        } else if (argument == "--mode=heuristic") {
+            run_options.is_exact = false;
+        } else if (argument == "--mode=exact") {
+            run_options.is_exact = true;
+        } else if (ParseFlag(argument, "time-limit", value)) {
+            run_options.exact.time_limit = std::stod(value);
+        } else if (ParseFlag(argument, "iterations", value)) {
+            run_options.search.iterations = std::stoull(value);
+        } else if (ParseFlag(argument, "time-budget", value)) {
+            run_options.search.time_limit = std::stod(value);
+        } else if (ParseFlag(argument, "top-k", value)) {
+            run_options.search.top_k = std::stoul(value);
+        } else if (ParseFlag(argument, "max-overlap", value)) {
+            run_options.search.max_overlap = std::stoul(value);
+        } else if (ParseFlag(argument, "target", value)) {
+            run_options.search.target_size = std::stoul(value);
+        } else if (ParseFlag(argument, "trace", value)) {
+            trace_file = value;
+            run_options.trace = true;
+        } else if (argument == "--progress") {
+            run_options.progress = true;
+        } else if (argument == "--improver=perturbation") {
+            run_options.search.improver = Improver::kPerturbation;
+        } else if (argument == "--improver=tabu") {
+            run_options.search.improver = Improver::kTabu;
+        } else if (argument == "--order=original") {
+            run_options.search.order = VertexOrder::kOriginal;
+        } else if (argument == "--order=degeneracy") {
+            run_options.search.order = VertexOrder::kDegeneracy;
+        } else if (argument == "--order=coloring") {
+            run_options.search.order = VertexOrder::kColoring;
+        } else if (argument == "--no-reduce") {
+            run_options.search.reduce = false;
+        } else if (argument == "--no-cache") {
+            run_options.use_cache = false;
+        } else if (ParseFlag(argument, "batch", value)) {
+            batch_source = value;
+        } else if (argument == "--serve") {
+            is_service = true;
+        } else if (ParseFlag(argument, "serve", value)) {
+            is_service = true;
+            socket_path = value;
+        } else if (ParseFlag(argument, "cache-mb", value)) {
+            cache_megabytes = std::stoul(value);
+        } else if (ParseFlag(argument, "checkpoint", value)) {
+            run_options.checkpoint_dir = value;
+        } else if (ParseFlag(argument, "checkpoint-interval", value)) {
+            run_options.checkpoint_interval = std::stod(value);
+        } else if (argument == "--resume") {
+            run_options.resume = true;
+        } else if (ParseFlag(argument, "instance", value)) {
+            instance = value;
+        } else if (ParseFlag(argument, "updates", value)) {
+            updates_file = value;
+        } else if (argument == "--simd=auto") {
+            SelectBitKernels(DetectSimdLevel());
+        } else if (argument == "--simd=scalar") {
+            SelectBitKernels(SimdLevel::kScalar);
+        } else if (argument == "--simd=avx2") {
+            SelectBitKernels(SimdLevel::kAvx2);
+        } else if (argument == "--simd=avx512") {
+            SelectBitKernels(SimdLevel::kAvx512);
+        } else if (argument == "--bench-kernels") {
+            is_kernel_benchmark = true;
+        } else if (argument == "--weights=file") {
+            run_options.weights = WeightSource::kFile;
+        } else if (argument == "--weights=mod200") {
+            run_options.weights = WeightSource::kSynthetic;
+        } else if (argument == "--bench-weighted") {
+            is_weighted_benchmark = true;
+        } else if (ParseFlag(argument, "rcl", value)) {
+            run_options.search.rcl_width = static_cast<uint32_t>(std::stoul(value));
+        } else if (argument == "--restart=none") {
+            run_options.search.restart = RestartPolicy::kNone;
+        } else if (argument == "--restart=luby") {
+            run_options.search.restart = RestartPolicy::kLuby;
+        } else if (argument == "--restart=geometric") {
+            run_options.search.restart = RestartPolicy::kGeometric;
+        } else if (ParseFlag(argument, "restart-unit", value)) {
+            run_options.search.restart_unit = std::stoull(value);
+        } else if (ParseFlag(argument, "restart-factor", value)) {
+            run_options.search.restart_factor = std::stod(value);
+        } else if (argument == "--bench-restarts") {
+            is_restart_benchmark = true;
+        } else if (ParseFlag(argument, "repeats", value)) {
+            repeats = static_cast<uint32_t>(std::stoul(value));
+        } else if (ParseFlag(argument, "jobs", value)) {
+            jobs = static_cast<uint32_t>(std::stoul(value));
+        } else if (ParseFlag(argument, "scaling", value)) {
+            for (const auto& threads_count: SplitString(value, ',')) {
+                scaling_threads.push_back(static_cast<uint32_t>(std::stoul(threads_count)));
+            }
+        } else {
+            std::cerr << "Unknown argument: " << argument << std::endl;
+            std::cerr << "Usage: " << argv[0]
+                      << " [--representation=list|matrix|csr|auto|compare] [--threads=N] [--seed=S]"
+                      << " [--mode=heuristic|exact] [--time-limit=SEC] [--scaling=1,2,4,...]"
+                      << " [--iterations=N] [--time-budget=SEC] [--target=K] [--trace=FILE] [--progress]"
+                      << " [--top-k=K] [--max-overlap=N] [--weights=file|mod200] [--bench-weighted]"
+                      << " [--rcl=K] [--restart=none|luby|geometric] [--restart-unit=N] [--restart-factor=F] [--bench-restarts]"
+                      << " [--improver=perturbation|tabu] [--batch=GLOB|MANIFEST] [--jobs=N]"
+                      << " [--repeats=K] [--order=original|degeneracy|coloring] [--instance=FILE --updates=FILE]"
+                      << " [--serve[=SOCKET]] [--cache-mb=N] [--checkpoint=DIR] [--checkpoint-interval=SEC] [--resume]"
+                      << " [--simd=auto|scalar|avx2|avx512] [--bench-kernels]"
+                      << " [--no-cache] [--no-reduce]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (run_options.search.iterations == 0 && run_options.search.time_limit <= 0) {
+        std::cerr << "--iterations=0 needs a --time-budget" << std::endl;
+        return 1;
+    }
+
+    if (run_options.weights != WeightSource::kNone &&
+        (run_options.search.improver == Improver::kTabu || run_options.search.top_k > 0)) {
+        std::cerr << "--weights does not work with --improver=tabu or --top-k" << std::endl;
+        return 1;
+    }
+
+    if (run_options.search.rcl_width == 0 || run_options.search.restart_unit == 0 ||
+        run_options.search.restart_factor < 1.0) {
+        std::cerr << "--rcl and --restart-unit must be positive, --restart-factor at least 1" << std::endl;
+        return 1;
+    }
+
+    if (run_options.resume && run_options.checkpoint_dir.empty()) {
+        std::cerr << "--resume needs a --checkpoint directory" << std::endl;
+        return 1;
+    }
+    if (run_options.resume && run_options.search.improver == Improver::kTabu) {
+        std::cerr << "--resume does not work with --improver=tabu" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> files = { "brock200_1.clq", "brock200_2.clq", "brock200_3.clq", "brock200_4.clq",
+                                       "brock400_1.clq", "brock400_2.clq", "brock400_3.clq", "brock400_4.clq",
+                                       "C125.9.clq",
+                                       "gen200_p0.9_44.clq", "gen200_p0.9_55.clq",
+                                       "hamming8-4.clq",
+                                       "johnson16-2-4.clq", "johnson8-2-4.clq",
+                                       "keller4.clq",
+                                       "MANN_a27.clq", "MANN_a9.clq",
+                                       "p_hat1000-1.clq", "p_hat1000-2.clq",
+                                       "p_hat1500-1.clq",
+                                       "p_hat300-3.clq", "p_hat500-3.clq",
+                                       "san1000.clq",
+                                       "sanr200_0.9.clq", "sanr400_0.7.clq"
+    };
+
+    if (!scaling_threads.empty()) {
+        RunScaling(files, run_options.search, run_options.exact, scaling_threads, run_options.use_cache);
+        return 0;
+    }
+
+    if (is_service) {
+        try {
+            RunService(socket_path, run_options, jobs, cache_megabytes * 1024 * 1024);
+        } catch (const std::exception& error) {
+            std::cerr << error.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!updates_file.empty()) {
+        if (instance.empty()) {
+            std::cerr << "--updates needs an --instance" << std::endl;
+            return 1;
+        }
+        try {
+            RunUpdates(instance, updates_file, run_options);
+        } catch (const std::exception& error) {
+            std::cerr << error.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (repeats > 0 || is_kernel_benchmark || is_weighted_benchmark || is_restart_benchmark) {
+        std::vector<std::pair<std::string, std::string>> instances;
+        if (batch_source.empty()) {
+            for (const auto& file: files) {
+                // The restart policies are compared on the brock and san families.
+                if (is_restart_benchmark && file.rfind("brock", 0) != 0 && file.rfind("san", 0) != 0) {
+                    continue;
+                }
+                instances.emplace_back("data/" + file, file);
+            }
+        } else {
+            for (const auto& path: ListInstances(batch_source)) {
+                instances.emplace_back(path, path);
+            }
+        }
+        if (is_kernel_benchmark) {
+            RunKernelBenchmark(instances, run_options.use_cache);
+        } else if (is_weighted_benchmark) {
+            RunWeightedBenchmark(instances, run_options);
+        } else if (is_restart_benchmark) {
+            RunRestartBenchmark(instances, run_options, repeats > 0 ? repeats : 5);
+        } else {
+            RunBenchmark(instances, run_options, repeats);
+        }
+        return 0;
+    }
+
+    std::ofstream fout("clique.csv");
+
+    std::ofstream trace_out;
+    if (run_options.trace) {
+        trace_out.open(trace_file);
+        trace_out << "File; Representation; Phase; Time (sec); Iteration; Clique" << std::endl;
+    }
+
+    PrintHeader(run_options, std::cout, fout);
+
+    std::ofstream profile_out;
+#ifdef MAX_CLIQUE_PROFILE
+    profile_out.open("profile.csv");
+    profile_out << "File; Kind; Name; Value (ms or count)" << std::endl;
+#endif
+
+    std::ofstream cliques_out;
+    if (run_options.search.top_k > 0) {
+        cliques_out.open("cliques.csv");
+        cliques_out << "File; Rank; Size; Vertices" << std::endl;
+    }
+
+    if (!batch_source.empty()) {
+        const auto paths = ListInstances(batch_source);
+        if (paths.empty()) {
+            std::cerr << "No instances in " << batch_source << std::endl;
+            return 1;
+        }
+        RunBatch(paths, run_options, jobs, std::cout, fout, trace_out, profile_out, cliques_out);
+        return 0;
+    }
+
+    for(const auto& file: files) {
+        const InstanceReport report = SolveInstance("data/" + file, file, run_options);
+        std::cout << report.console;
+        fout << report.csv;
+        trace_out << report.trace;
+        profile_out << report.profile;
+        cliques_out << report.cliques;
+    }
+
+    fout.close();
+    return 0;
+}